@@ -0,0 +1,147 @@
+#!/usr/bin/env bash
+# Runs the Flint benchmark programs and checks them against stored baselines.
+#
+# usage: benchmarks/run.sh [-n RUNS] [-t PERCENT] [-f FLINT] [-u] [NAME ...]
+#   -n RUNS     runs per program (default 5)
+#   -t PERCENT  slowdown over a baseline median that counts as a regression
+#               (default 10)
+#   -f FLINT    interpreter to benchmark (default ./flint)
+#   -u          record the measured medians in baselines.txt instead of
+#               comparing against it
+#   NAME ...    programs to run, without .fln (default: all of them)
+#
+# Prints the median and variance of each program's wall-clock time. Exits
+# with status 1 if a program fails or regresses, so it can gate a rollout.
+# Baselines are machine-specific: record them on the machine that checks.
+
+set -u
+
+dir=$(cd "$(dirname "$0")" && pwd)
+baselines="$dir/baselines.txt"
+runs=5
+threshold=10
+flint=./flint
+update=0
+
+usage() {
+    sed -n '4,11p' "$0" | sed 's/^# \{0,1\}//' >&2
+    exit 2
+}
+
+while getopts "n:t:f:uh" option; do
+    case $option in
+        n) runs=$OPTARG ;;
+        t) threshold=$OPTARG ;;
+        f) flint=$OPTARG ;;
+        u) update=1 ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ ! -x "$flint" ]; then
+    echo "error: no interpreter at '$flint' (use -f)" >&2
+    exit 2
+fi
+
+if [ $# -gt 0 ]; then
+    programs=()
+    for name in "$@"; do
+        programs+=("$dir/$name.fln")
+    done
+else
+    programs=("$dir"/*.fln)
+fi
+
+now() {
+    if [ -n "${EPOCHREALTIME:-}" ]; then
+        echo "${EPOCHREALTIME/,/.}"
+    else
+        date +%s.%N
+    fi
+}
+
+baseline_for() {
+    [ -f "$baselines" ] && awk -v name="$1" '$1 == name { print $2 }' "$baselines"
+}
+
+errors=$(mktemp)
+trap 'rm -f "$errors"' EXIT
+status=0
+measured=""
+
+for program in "${programs[@]}"; do
+    name=$(basename "$program" .fln)
+    if [ ! -f "$program" ]; then
+        printf '%-16s MISSING\n' "$name"
+        status=1
+        continue
+    fi
+
+    times=()
+    failed=0
+    for ((run = 0; run < runs; run++)); do
+        start=$(now)
+        "$flint" "$program" < /dev/null > /dev/null 2> "$errors"
+        exit_code=$?
+        end=$(now)
+        if [ $exit_code -ne 0 ]; then
+            printf '%-16s FAILED (exit %d): %s\n' "$name" "$exit_code" "$(head -n 1 "$errors")"
+            failed=1
+            status=1
+            break
+        fi
+        times+=("$(awk -v start="$start" -v end="$end" 'BEGIN { printf "%.6f", end - start }')")
+    done
+    [ $failed -eq 1 ] && continue
+
+    read -r median variance < <(printf '%s\n' "${times[@]}" | sort -g | awk '
+        { t[NR] = $1; sum += $1 }
+        END {
+            median = NR % 2 ? t[(NR + 1) / 2] : (t[NR / 2] + t[NR / 2 + 1]) / 2
+            mean = sum / NR
+            for (i = 1; i <= NR; i++) squares += (t[i] - mean) ^ 2
+            printf "%.6f %.3e\n", median, (NR > 1 ? squares / (NR - 1) : 0)
+        }')
+
+    if [ $update -eq 1 ]; then
+        measured+="$name $median"$'\n'
+        printf '%-16s median %ss  variance %s  (recorded)\n' "$name" "$median" "$variance"
+        continue
+    fi
+
+    baseline=$(baseline_for "$name")
+    if [ -z "$baseline" ]; then
+        printf '%-16s median %ss  variance %s  (no baseline)\n' "$name" "$median" "$variance"
+        continue
+    fi
+
+    read -r change regressed < <(awk -v median="$median" -v baseline="$baseline" -v threshold="$threshold" '
+        BEGIN {
+            change = baseline > 0 ? (median - baseline) / baseline * 100 : 0
+            printf "%+.1f %d\n", change, (change > threshold)
+        }')
+    if [ "$regressed" -eq 1 ]; then
+        verdict="SLOWER"
+        status=1
+    else
+        verdict="ok"
+    fi
+    printf '%-16s median %ss  variance %s  baseline %ss  %s%%  %s\n' \
+        "$name" "$median" "$variance" "$baseline" "$change" "$verdict"
+done
+
+# Entries for programs that weren't run are kept as they were.
+if [ $update -eq 1 ] && [ -n "$measured" ]; then
+    {
+        echo "# Median wall-clock seconds per benchmark, written by run.sh -u."
+        echo "# name median"
+        [ -f "$baselines" ] && grep -v '^#' "$baselines" | while read -r name value; do
+            [ -n "$name" ] && ! grep -q "^$name " <<< "$measured" && echo "$name $value"
+        done
+        printf '%s' "$measured"
+    } > "$baselines.tmp"
+    mv "$baselines.tmp" "$baselines"
+fi
+
+exit $status
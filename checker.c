@@ -0,0 +1,882 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "checker.h"
+
+typedef struct {
+    const char* name;
+    ValueType type;
+    bool annotated;
+    bool seen;
+    int seen_at;
+} Symbol;
+
+typedef struct Scope {
+    Symbol* symbols;
+    int count;
+    int capacity;
+    bool changed;
+    struct Scope* enclosing;
+} Scope;
+
+// Types are inferred per scope in two phases: first the scope's statements
+// are walked silently until every variable's type stops changing, then they
+// are walked once more to annotate expressions and report errors. Command
+// bodies are walked in both phases, since they can widen outer variables.
+typedef struct {
+    Scope* scope;
+    bool report;
+    int error_count;
+    int mismatch_count;
+    Statement** commands;
+    int command_count;
+    int command_capacity;
+    int seen_clock;
+    const ErrorReporter* reporter;
+} Checker;
+
+static ValueType check_expression(Checker* c, Expression* expr);
+static void check_statement(Checker* c, Statement* stmt);
+
+static void checker_error(Checker* c, const char* kind, int line, const char* format, va_list args) {
+    c->mismatch_count++;
+    if (!c->report) return;
+    char message[400];
+    vsnprintf(message, sizeof(message), format, args);
+    report_error(c->reporter, "%s on line %d: %s", kind, line, message);
+    c->error_count++;
+}
+
+static void type_error(Checker* c, int line, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    checker_error(c, "TypeError", line, format, args);
+    va_end(args);
+}
+
+static void parallel_error(Checker* c, int line, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    checker_error(c, "ParallelError", line, format, args);
+    va_end(args);
+}
+
+// Also returns the scope holding the symbol, whose fixpoint has to run
+// again when the symbol changes.
+static Symbol* lookup_in(Scope* scope, const char* name, Scope** owner) {
+    for (; scope != NULL; scope = scope->enclosing) {
+        for (int i = 0; i < scope->count; i++) {
+            if (strcmp(scope->symbols[i].name, name) == 0) {
+                if (owner != NULL) *owner = scope;
+                return &scope->symbols[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+static Symbol* lookup(Scope* scope, const char* name) {
+    return lookup_in(scope, name, NULL);
+}
+
+static void declare(Checker* c, const char* name, ValueType type, bool annotated) {
+    Scope* scope = c->scope;
+    if (scope->count >= scope->capacity) {
+        scope->capacity = scope->capacity ? scope->capacity * 2 : 16;
+        scope->symbols = realloc(scope->symbols, sizeof(Symbol) * scope->capacity);
+    }
+    scope->symbols[scope->count].name = name;
+    scope->symbols[scope->count].type = type;
+    scope->symbols[scope->count].annotated = annotated;
+    scope->symbols[scope->count].seen = true;
+    scope->symbols[scope->count].seen_at = c->seen_clock++;
+    scope->count++;
+    scope->changed = true;
+}
+
+// Records an assignment of `type` to `name`. Unannotated variables only keep
+// a proven type while every assignment to them agrees.
+static void assign(Checker* c, const char* name, ValueType type, int line) {
+    Scope* owner = NULL;
+    Symbol* symbol = lookup_in(c->scope, name, &owner);
+    if (symbol == NULL) {
+        declare(c, name, type, false);
+        return;
+    }
+    if (symbol->annotated) {
+        if (type != TYPE_UNKNOWN && type != symbol->type) {
+            type_error(c, line, "Cannot assign %s to '%s' declared as %s.",
+                value_type_to_string(type), name, value_type_to_string(symbol->type));
+        }
+        return;
+    }
+    if (symbol->type != TYPE_UNKNOWN && symbol->type != type) {
+        symbol->type = TYPE_UNKNOWN;
+        owner->changed = true;
+    }
+}
+
+// Drops the proven type of an existing, unannotated variable.
+static void widen(Checker* c, const char* name) {
+    Scope* owner = NULL;
+    Symbol* symbol = lookup_in(c->scope, name, &owner);
+    if (symbol != NULL && !symbol->annotated && symbol->type != TYPE_UNKNOWN) {
+        symbol->type = TYPE_UNKNOWN;
+        owner->changed = true;
+    }
+}
+
+// A value that is itself ill-typed says nothing about the variable, and
+// widening the variable from it would hide that error from the reporting
+// pass (`s = "a"` then `s = s + 1`).
+static void assign_value(Checker* c, const char* name, ValueType type, bool ill_typed, int line) {
+    if (ill_typed && lookup(c->scope, name) != NULL) return;
+    assign(c, name, ill_typed ? TYPE_UNKNOWN : type, line);
+}
+
+static void expect_type(Checker* c, ValueType actual, ValueType expected, int line, const char* what) {
+    if (actual != TYPE_UNKNOWN && actual != expected) {
+        type_error(c, line, "%s must be %s, got %s.", what,
+            value_type_to_string(expected), value_type_to_string(actual));
+    }
+}
+
+static bool is_builtin_text_command(const char* name) {
+    return strcmp(name, "upper") == 0 || strcmp(name, "lower") == 0 ||
+        strcmp(name, "trim") == 0 || strcmp(name, "reverse") == 0;
+}
+
+static ValueType check_binary(Checker* c, Expression* expr) {
+    ValueType left = check_expression(c, expr->as.binary.left);
+    ValueType right = check_expression(c, expr->as.binary.right);
+    const char* op = expr->as.binary.op.value;
+    int line = expr->base.line;
+    bool known = left != TYPE_UNKNOWN && right != TYPE_UNKNOWN;
+
+    if (strcmp(op, "+") == 0) {
+        if (known && left == right && (left == TYPE_NUM || left == TYPE_TEXT || left == TYPE_LIST)) return left;
+        if (known) {
+            type_error(c, line, "Cannot apply '+' to %s and %s.",
+                value_type_to_string(left), value_type_to_string(right));
+        }
+        return TYPE_UNKNOWN;
+    }
+    if (strcmp(op, "-") == 0 || strcmp(op, "*") == 0 || strcmp(op, "/") == 0 || strcmp(op, "%") == 0) {
+        expect_type(c, left, TYPE_NUM, line, "Left operand of arithmetic");
+        expect_type(c, right, TYPE_NUM, line, "Right operand of arithmetic");
+        return TYPE_NUM;
+    }
+    if (strcmp(op, "and") == 0 || strcmp(op, "or") == 0) {
+        expect_type(c, left, TYPE_BOOL, line, "Left operand of logical operator");
+        expect_type(c, right, TYPE_BOOL, line, "Right operand of logical operator");
+        return TYPE_BOOL;
+    }
+    if (strcmp(op, "==") == 0 || strcmp(op, "!=") == 0) {
+        return TYPE_BOOL;
+    }
+    if (known && (left != right || (left != TYPE_NUM && left != TYPE_TEXT))) {
+        type_error(c, line, "Cannot compare %s and %s with '%s'.",
+            value_type_to_string(left), value_type_to_string(right), op);
+    }
+    return TYPE_BOOL;
+}
+
+static ValueType check_expression(Checker* c, Expression* expr) {
+    if (expr == NULL) return TYPE_UNKNOWN;
+    ValueType type = TYPE_UNKNOWN;
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            switch (expr->as.literal.literal.type) {
+                case T_NUMBER: type = TYPE_NUM; break;
+                case T_STRING: type = TYPE_TEXT; break;
+                case T_BOOL: type = TYPE_BOOL; break;
+                default: break;
+            }
+            break;
+        case EXPR_IDENTIFIER: {
+            Symbol* symbol = lookup(c->scope, expr->as.identifier.identifier.value);
+            if (symbol != NULL) type = symbol->type;
+            break;
+        }
+        case EXPR_BINARY:
+            type = check_binary(c, expr);
+            break;
+        case EXPR_UNARY: {
+            ValueType right = check_expression(c, expr->as.unary.right);
+            const char* op = expr->as.unary.op.value;
+            if (strcmp(op, "-") == 0 || strcmp(op, "+") == 0) {
+                char what[16];
+                snprintf(what, sizeof(what), "Operand of '%s'", op);
+                expect_type(c, right, TYPE_NUM, expr->base.line, what);
+                type = TYPE_NUM;
+            } else if (strcmp(op, "not") == 0) {
+                expect_type(c, right, TYPE_BOOL, expr->base.line, "Operand of 'not'");
+                type = TYPE_BOOL;
+            } else {
+                type_error(c, expr->base.line, "'%s' can't be used as a unary operator.", op);
+            }
+            break;
+        }
+        case EXPR_GROUPING:
+            type = check_expression(c, expr->as.grouping.expression);
+            break;
+        case EXPR_IN: {
+            check_expression(c, expr->as.in_expr.left);
+            ValueType right = check_expression(c, expr->as.in_expr.right);
+            if (right != TYPE_UNKNOWN && right != TYPE_LIST && right != TYPE_MAP && right != TYPE_TEXT) {
+                type_error(c, expr->base.line, "Right operand of 'in' must be list, map or text, got %s.",
+                    value_type_to_string(right));
+            }
+            type = TYPE_BOOL;
+            break;
+        }
+        case EXPR_CALL: {
+            Expression* callee = expr->as.call.callee;
+            check_expression(c, callee);
+            for (int i = 0; i < expr->as.call.count; i++) {
+                ValueType arg = check_expression(c, expr->as.call.args[i]);
+                if (callee->type == EXPR_IDENTIFIER && is_builtin_text_command(callee->as.identifier.identifier.value)) {
+                    expect_type(c, arg, TYPE_TEXT, expr->base.line, "Argument of text command");
+                }
+            }
+            if (callee->type == EXPR_IDENTIFIER && is_builtin_text_command(callee->as.identifier.identifier.value)) {
+                type = TYPE_TEXT;
+            }
+            break;
+        }
+        case EXPR_GET:
+            check_expression(c, expr->as.get.object);
+            break;
+        case EXPR_LIST:
+            for (int i = 0; i < expr->as.list.count; i++) {
+                check_expression(c, expr->as.list.elements[i]);
+            }
+            type = TYPE_LIST;
+            break;
+        case EXPR_MAP:
+            for (int i = 0; i < expr->as.map.count; i++) {
+                check_expression(c, expr->as.map.keys[i]);
+                check_expression(c, expr->as.map.values[i]);
+            }
+            type = TYPE_MAP;
+            break;
+    }
+
+    expr->value_type = type;
+    return type;
+}
+
+static void mark_seen(Checker* c, const char* name) {
+    Symbol* symbol = lookup(c->scope, name);
+    if (symbol != NULL && c->report && !symbol->seen) {
+        symbol->seen = true;
+        symbol->seen_at = c->seen_clock++;
+    }
+}
+
+static bool is_shared(Checker* c, const char* name) {
+    Symbol* symbol = lookup(c->scope, name);
+    return symbol != NULL && symbol->seen;
+}
+
+static bool reads_variable(Expression* expr, const char* name) {
+    if (expr == NULL) return false;
+    switch (expr->type) {
+        case EXPR_IDENTIFIER:
+            return strcmp(expr->as.identifier.identifier.value, name) == 0;
+        case EXPR_BINARY:
+            return reads_variable(expr->as.binary.left, name) || reads_variable(expr->as.binary.right, name);
+        case EXPR_UNARY:
+            return reads_variable(expr->as.unary.right, name);
+        case EXPR_GROUPING:
+            return reads_variable(expr->as.grouping.expression, name);
+        case EXPR_IN:
+            return reads_variable(expr->as.in_expr.left, name) || reads_variable(expr->as.in_expr.right, name);
+        case EXPR_GET:
+            return reads_variable(expr->as.get.object, name);
+        case EXPR_CALL:
+            if (reads_variable(expr->as.call.callee, name)) return true;
+            for (int i = 0; i < expr->as.call.count; i++) {
+                if (reads_variable(expr->as.call.args[i], name)) return true;
+            }
+            return false;
+        case EXPR_LIST:
+            for (int i = 0; i < expr->as.list.count; i++) {
+                if (reads_variable(expr->as.list.elements[i], name)) return true;
+            }
+            return false;
+        case EXPR_MAP:
+            for (int i = 0; i < expr->as.map.count; i++) {
+                if (reads_variable(expr->as.map.keys[i], name) || reads_variable(expr->as.map.values[i], name)) return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+// A shared variable may only be updated as `x = x + e` or `x = x * e`
+// (including `x += e`, `x *= e`, `x++`) with `e` not reading `x`; the
+// runtime gives each worker its own partial value and combines them after
+// the loop. Returns the reduction operator, or NULL if `value` isn't one.
+static const char* reduction_operator(Expression* value, const char* name) {
+    if (value == NULL || value->type != EXPR_BINARY) return NULL;
+    const char* op = value->as.binary.op.value;
+    if (strcmp(op, "+") != 0 && strcmp(op, "*") != 0) return NULL;
+    Expression* left = value->as.binary.left;
+    if (left->type != EXPR_IDENTIFIER || strcmp(left->as.identifier.identifier.value, name) != 0) return NULL;
+    if (reads_variable(value->as.binary.right, name)) return NULL;
+    return op;
+}
+
+typedef struct {
+    const char* name;
+    const char* op;
+} Reduction;
+
+typedef struct {
+    Reduction* items;
+    int count;
+    int capacity;
+} ReductionList;
+
+static Reduction* find_reduction(ReductionList* list, const char* name) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->items[i].name, name) == 0) return &list->items[i];
+    }
+    return NULL;
+}
+
+static const char* target_root(Expression* target) {
+    while (target != NULL && target->type == EXPR_GET) target = target->as.get.object;
+    return target != NULL && target->type == EXPR_IDENTIFIER ? target->as.identifier.identifier.value : NULL;
+}
+
+static void find_parallel_writes(Checker* c, Statement** body, int count, ReductionList* reductions);
+
+static void find_parallel_write(Checker* c, Statement* stmt, ReductionList* reductions) {
+    if (stmt == NULL) return;
+    const char* name = NULL;
+    Expression* value = NULL;
+    switch (stmt->type) {
+        case STMT_LET_ASSIGN:
+            name = stmt->as.let_assign.name.value;
+            value = stmt->as.let_assign.initializer;
+            break;
+        case STMT_REASSIGN:
+            if (stmt->as.reassign.target->type != EXPR_IDENTIFIER) {
+                const char* root = target_root(stmt->as.reassign.target);
+                if (root != NULL && is_shared(c, root)) {
+                    parallel_error(c, stmt->base.line, "Parallel loop writes to a field of shared variable '%s'.", root);
+                }
+                return;
+            }
+            name = stmt->as.reassign.target->as.identifier.identifier.value;
+            value = stmt->as.reassign.value;
+            break;
+        case STMT_ASK:
+            if (is_shared(c, stmt->as.ask_stmt.variable.value)) {
+                parallel_error(c, stmt->base.line, "Parallel loop asks into shared variable '%s'.",
+                    stmt->as.ask_stmt.variable.value);
+            }
+            return;
+        case STMT_BREAK:
+            parallel_error(c, stmt->base.line, "'break' is not allowed in a parallel loop.");
+            return;
+        case STMT_RETURN:
+            parallel_error(c, stmt->base.line, "'return' is not allowed in a parallel loop.");
+            return;
+        case STMT_WHILE:
+            find_parallel_writes(c, stmt->as.while_stmt.body, stmt->as.while_stmt.body_count, reductions);
+            return;
+        case STMT_LOOP:
+            find_parallel_writes(c, stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count, reductions);
+            return;
+        case STMT_CHECK:
+            for (int i = 0; i < stmt->as.check_stmt.case_count; i++) {
+                find_parallel_writes(c, stmt->as.check_stmt.cases[i].body, stmt->as.check_stmt.cases[i].body_count, reductions);
+            }
+            return;
+        default:
+            return;
+    }
+
+    if (!is_shared(c, name)) return;
+    const char* op = reduction_operator(value, name);
+    if (op == NULL) {
+        parallel_error(c, stmt->base.line,
+            "Parallel loop writes to shared variable '%s'; only '%s = %s + ...' or '%s = %s * ...' reductions are allowed.",
+            name, name, name, name, name);
+        return;
+    }
+    // Partial values are combined in no particular order, which only
+    // matters for text.
+    Symbol* symbol = lookup(c->scope, name);
+    if (symbol != NULL && symbol->type == TYPE_TEXT) {
+        parallel_error(c, stmt->base.line, "Reduction into '%s' must be a num or list, got text.", name);
+        return;
+    }
+    Reduction* existing = find_reduction(reductions, name);
+    if (existing != NULL) {
+        if (strcmp(existing->op, op) != 0) {
+            parallel_error(c, stmt->base.line, "Reduction into '%s' mixes '%s' and '%s'.", name, existing->op, op);
+        }
+        return;
+    }
+    if (reductions->count >= reductions->capacity) {
+        reductions->capacity = reductions->capacity ? reductions->capacity * 2 : 4;
+        reductions->items = realloc(reductions->items, sizeof(Reduction) * reductions->capacity);
+    }
+    reductions->items[reductions->count].name = name;
+    reductions->items[reductions->count].op = op;
+    reductions->count++;
+}
+
+static void find_parallel_writes(Checker* c, Statement** body, int count, ReductionList* reductions) {
+    for (int i = 0; i < count; i++) {
+        find_parallel_write(c, body[i], reductions);
+    }
+}
+
+static void check_reduction_reads(Checker* c, Statement** body, int count, ReductionList* reductions);
+
+static void check_reduction_expression(Checker* c, Expression* expr, int line, ReductionList* reductions) {
+    for (int i = 0; i < reductions->count; i++) {
+        if (reads_variable(expr, reductions->items[i].name)) {
+            parallel_error(c, line, "Reduction variable '%s' can't be read inside the parallel loop.",
+                reductions->items[i].name);
+        }
+    }
+}
+
+// Skips the `x` in `x = x + e` when `x` is a reduction variable.
+static Expression* reduction_operand(Expression* value, const char* name, ReductionList* reductions) {
+    if (value != NULL && value->type == EXPR_BINARY && find_reduction(reductions, name)) {
+        return value->as.binary.right;
+    }
+    return value;
+}
+
+// Partial values are private to each worker, so a reduction variable can't
+// be observed inside the loop except by its own update.
+static void check_reduction_read(Checker* c, Statement* stmt, ReductionList* reductions) {
+    if (stmt == NULL) return;
+    int line = stmt->base.line;
+    switch (stmt->type) {
+        case STMT_LET_ASSIGN:
+            check_reduction_expression(c, reduction_operand(stmt->as.let_assign.initializer,
+                stmt->as.let_assign.name.value, reductions), line, reductions);
+            break;
+        case STMT_REASSIGN: {
+            Expression* target = stmt->as.reassign.target;
+            if (target->type == EXPR_IDENTIFIER) {
+                check_reduction_expression(c, reduction_operand(stmt->as.reassign.value,
+                    target->as.identifier.identifier.value, reductions), line, reductions);
+            } else {
+                check_reduction_expression(c, target, line, reductions);
+                check_reduction_expression(c, stmt->as.reassign.value, line, reductions);
+            }
+            break;
+        }
+        case STMT_WHILE:
+            check_reduction_expression(c, stmt->as.while_stmt.condition, line, reductions);
+            check_reduction_reads(c, stmt->as.while_stmt.body, stmt->as.while_stmt.body_count, reductions);
+            break;
+        case STMT_LOOP:
+            check_reduction_expression(c, stmt->as.loop_stmt.count, line, reductions);
+            check_reduction_reads(c, stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count, reductions);
+            break;
+        case STMT_CHECK:
+            check_reduction_expression(c, stmt->as.check_stmt.subject, line, reductions);
+            for (int i = 0; i < stmt->as.check_stmt.case_count; i++) {
+                CheckCase* check_case = &stmt->as.check_stmt.cases[i];
+                check_reduction_expression(c, check_case->value, check_case->value ? check_case->value->base.line : line, reductions);
+                check_reduction_reads(c, check_case->body, check_case->body_count, reductions);
+            }
+            break;
+        case STMT_WRITE:
+            check_reduction_expression(c, stmt->as.write_stmt.expression, line, reductions);
+            break;
+        case STMT_ASK:
+            check_reduction_expression(c, stmt->as.ask_stmt.prompt, line, reductions);
+            break;
+        case STMT_EXPR:
+            check_reduction_expression(c, stmt->as.expr_stmt.expression, line, reductions);
+            break;
+        default:
+            break;
+    }
+}
+
+static void check_reduction_reads(Checker* c, Statement** body, int count, ReductionList* reductions) {
+    for (int i = 0; i < count; i++) {
+        check_reduction_read(c, body[i], reductions);
+    }
+}
+
+static Statement* find_command(Checker* c, const char* name) {
+    for (int i = c->command_count - 1; i >= 0; i--) {
+        if (strcmp(c->commands[i]->as.command_def.name.value, name) == 0) return c->commands[i];
+    }
+    return NULL;
+}
+
+static void add_command(Checker* c, Statement* command) {
+    if (c->command_count >= c->command_capacity) {
+        c->command_capacity = c->command_capacity ? c->command_capacity * 2 : 8;
+        c->commands = realloc(c->commands, sizeof(Statement*) * c->command_capacity);
+    }
+    c->commands[c->command_count++] = command;
+}
+
+typedef struct {
+    Statement** items;
+    int count;
+    int capacity;
+} CommandList;
+
+static void find_call_writes(Checker* c, Statement** body, int count, Statement* command, int line,
+                             CommandList* visited, ReductionList* reductions);
+
+static bool is_param(Statement* command, const char* name) {
+    for (int i = 0; i < command->as.command_def.param_count; i++) {
+        if (strcmp(command->as.command_def.params[i].value, name) == 0) return true;
+    }
+    return false;
+}
+
+static void check_command_write(Checker* c, Statement* command, const char* name, int line) {
+    if (name == NULL || is_param(command, name) || !is_shared(c, name)) return;
+    parallel_error(c, line, "Parallel loop calls '%s', which writes shared variable '%s'.",
+        command->as.command_def.name.value, name);
+}
+
+static void check_command_read(Checker* c, Statement* command, Expression* expr, int line, ReductionList* reductions) {
+    for (int i = 0; i < reductions->count; i++) {
+        const char* name = reductions->items[i].name;
+        if (!is_param(command, name) && reads_variable(expr, name)) {
+            parallel_error(c, line, "Parallel loop calls '%s', which reads reduction variable '%s'.",
+                command->as.command_def.name.value, name);
+        }
+    }
+}
+
+static void find_expression_calls(Checker* c, Expression* expr, int line, CommandList* visited, ReductionList* reductions) {
+    if (expr == NULL) return;
+    switch (expr->type) {
+        case EXPR_CALL: {
+            Expression* callee = expr->as.call.callee;
+            Statement* command = callee->type == EXPR_IDENTIFIER ? find_command(c, callee->as.identifier.identifier.value) : NULL;
+            bool seen = false;
+            for (int i = 0; command != NULL && i < visited->count; i++) {
+                if (visited->items[i] == command) seen = true;
+            }
+            if (command != NULL && !seen && command->as.command_def.parsed) {
+                if (visited->count >= visited->capacity) {
+                    visited->capacity = visited->capacity ? visited->capacity * 2 : 4;
+                    visited->items = realloc(visited->items, sizeof(Statement*) * visited->capacity);
+                }
+                visited->items[visited->count++] = command;
+                find_call_writes(c, command->as.command_def.body, command->as.command_def.body_count, command, line, visited, reductions);
+            }
+            for (int i = 0; i < expr->as.call.count; i++) {
+                find_expression_calls(c, expr->as.call.args[i], line, visited, reductions);
+            }
+            break;
+        }
+        case EXPR_BINARY:
+            find_expression_calls(c, expr->as.binary.left, line, visited, reductions);
+            find_expression_calls(c, expr->as.binary.right, line, visited, reductions);
+            break;
+        case EXPR_UNARY:
+            find_expression_calls(c, expr->as.unary.right, line, visited, reductions);
+            break;
+        case EXPR_GROUPING:
+            find_expression_calls(c, expr->as.grouping.expression, line, visited, reductions);
+            break;
+        case EXPR_IN:
+            find_expression_calls(c, expr->as.in_expr.left, line, visited, reductions);
+            find_expression_calls(c, expr->as.in_expr.right, line, visited, reductions);
+            break;
+        case EXPR_GET:
+            find_expression_calls(c, expr->as.get.object, line, visited, reductions);
+            break;
+        case EXPR_LIST:
+            for (int i = 0; i < expr->as.list.count; i++) {
+                find_expression_calls(c, expr->as.list.elements[i], line, visited, reductions);
+            }
+            break;
+        case EXPR_MAP:
+            for (int i = 0; i < expr->as.map.count; i++) {
+                find_expression_calls(c, expr->as.map.keys[i], line, visited, reductions);
+                find_expression_calls(c, expr->as.map.values[i], line, visited, reductions);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void find_expression_uses(Checker* c, Expression* expr, Statement* command, int line,
+                                 CommandList* visited, ReductionList* reductions) {
+    if (command != NULL) check_command_read(c, command, expr, line, reductions);
+    find_expression_calls(c, expr, line, visited, reductions);
+}
+
+// Walks a parallel loop body (`command` NULL) or the body of a command it
+// calls, following every call to a known command. Writes inside a called
+// command reach the caller's variables, so any that lands on a shared
+// variable is reported at the loop statement making the call, as is any
+// read of a reduction variable's per-worker partial value.
+static void find_call_writes(Checker* c, Statement** body, int count, Statement* command, int line,
+                             CommandList* visited, ReductionList* reductions) {
+    for (int i = 0; i < count; i++) {
+        Statement* stmt = body[i];
+        if (stmt == NULL) continue;
+        int call_line = command == NULL ? stmt->base.line : line;
+        switch (stmt->type) {
+            case STMT_LET_ASSIGN:
+                find_expression_uses(c, stmt->as.let_assign.initializer, command, call_line, visited, reductions);
+                if (command != NULL) check_command_write(c, command, stmt->as.let_assign.name.value, call_line);
+                break;
+            case STMT_REASSIGN:
+                find_expression_uses(c, stmt->as.reassign.value, command, call_line, visited, reductions);
+                find_expression_calls(c, stmt->as.reassign.target, call_line, visited, reductions);
+                if (command != NULL) check_command_write(c, command, target_root(stmt->as.reassign.target), call_line);
+                break;
+            case STMT_ASK:
+                find_expression_uses(c, stmt->as.ask_stmt.prompt, command, call_line, visited, reductions);
+                if (command != NULL) check_command_write(c, command, stmt->as.ask_stmt.variable.value, call_line);
+                break;
+            case STMT_WHILE:
+                find_expression_uses(c, stmt->as.while_stmt.condition, command, call_line, visited, reductions);
+                find_call_writes(c, stmt->as.while_stmt.body, stmt->as.while_stmt.body_count, command, call_line, visited, reductions);
+                break;
+            case STMT_LOOP:
+                find_expression_uses(c, stmt->as.loop_stmt.count, command, call_line, visited, reductions);
+                find_call_writes(c, stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count, command, call_line, visited, reductions);
+                break;
+            case STMT_CHECK:
+                find_expression_uses(c, stmt->as.check_stmt.subject, command, call_line, visited, reductions);
+                for (int j = 0; j < stmt->as.check_stmt.case_count; j++) {
+                    CheckCase* check_case = &stmt->as.check_stmt.cases[j];
+                    find_expression_uses(c, check_case->value, command, call_line, visited, reductions);
+                    find_call_writes(c, check_case->body, check_case->body_count, command, call_line, visited, reductions);
+                }
+                break;
+            case STMT_WRITE:
+                find_expression_uses(c, stmt->as.write_stmt.expression, command, call_line, visited, reductions);
+                break;
+            case STMT_RETURN:
+                find_expression_uses(c, stmt->as.return_stmt.value, command, call_line, visited, reductions);
+                break;
+            case STMT_EXPR:
+                find_expression_uses(c, stmt->as.expr_stmt.expression, command, call_line, visited, reductions);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void check_parallel_loop(Checker* c, Statement* stmt) {
+    ReductionList reductions = { .items = NULL, .count = 0, .capacity = 0 };
+    find_parallel_writes(c, stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count, &reductions);
+    check_reduction_reads(c, stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count, &reductions);
+
+    CommandList visited = { .items = NULL, .count = 0, .capacity = 0 };
+    find_call_writes(c, stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count, NULL, stmt->base.line,
+        &visited, &reductions);
+    free(visited.items);
+    free(reductions.items);
+}
+
+static void check_body(Checker* c, Statement** body, int count) {
+    for (int i = 0; i < count; i++) {
+        check_statement(c, body[i]);
+    }
+}
+
+static void check_in_scope(Checker* c, Scope* scope, Statement** body, int count, Token* params, int param_count) {
+    Scope* saved_scope = c->scope;
+    bool saved_report = c->report;
+    int saved_command_count = c->command_count;
+    c->scope = scope;
+
+    for (int i = 0; i < param_count; i++) {
+        declare(c, params[i].value, TYPE_UNKNOWN, false);
+    }
+
+    c->report = false;
+    do {
+        scope->changed = false;
+        check_body(c, body, count);
+    } while (scope->changed);
+
+    // `seen` tracks which variables have been assigned so far in program
+    // order, which is what parallel loops need to tell shared from local.
+    for (int i = param_count; i < scope->count; i++) {
+        scope->symbols[i].seen = false;
+    }
+    c->report = saved_report;
+    check_body(c, body, count);
+
+    c->scope = saved_scope;
+    c->command_count = saved_command_count;
+}
+
+static void check_scope(Checker* c, Statement** body, int count, Token* params, int param_count) {
+    Scope scope = { .symbols = NULL, .count = 0, .capacity = 0, .changed = false, .enclosing = c->scope };
+    check_in_scope(c, &scope, body, count, params, param_count);
+    free(scope.symbols);
+}
+
+static void check_statement(Checker* c, Statement* stmt) {
+    if (stmt == NULL) return;
+    switch (stmt->type) {
+        case STMT_LET_ASSIGN: {
+            int mismatches = c->mismatch_count;
+            ValueType type = check_expression(c, stmt->as.let_assign.initializer);
+            bool ill_typed = c->mismatch_count != mismatches;
+            ValueType declared = stmt->as.let_assign.declared_type;
+            const char* name = stmt->as.let_assign.name.value;
+            Scope* owner = NULL;
+            Symbol* symbol = lookup_in(c->scope, name, &owner);
+            if (declared == TYPE_UNKNOWN) {
+                assign_value(c, name, type, ill_typed, stmt->base.line);
+            } else if (symbol == NULL) {
+                declare(c, name, declared, true);
+            } else if (symbol->annotated && symbol->type != declared) {
+                type_error(c, stmt->base.line, "'%s' already declared as %s.",
+                    name, value_type_to_string(symbol->type));
+            } else if (!symbol->annotated) {
+                symbol->type = declared;
+                symbol->annotated = true;
+                owner->changed = true;
+            }
+            if (declared != TYPE_UNKNOWN && type != TYPE_UNKNOWN && type != declared) {
+                type_error(c, stmt->base.line, "Cannot assign %s to '%s' declared as %s.",
+                    value_type_to_string(type), name, value_type_to_string(declared));
+            }
+            mark_seen(c, name);
+            break;
+        }
+        case STMT_REASSIGN: {
+            int mismatches = c->mismatch_count;
+            ValueType type = check_expression(c, stmt->as.reassign.value);
+            bool ill_typed = c->mismatch_count != mismatches;
+            Expression* target = stmt->as.reassign.target;
+            if (target->type == EXPR_IDENTIFIER) {
+                assign_value(c, target->as.identifier.identifier.value, type, ill_typed, target->base.line);
+                target->value_type = lookup(c->scope, target->as.identifier.identifier.value)->type;
+                mark_seen(c, target->as.identifier.identifier.value);
+            } else {
+                check_expression(c, target);
+            }
+            // `s += piece` lowers to text_append (or list_extend), which
+            // reuses the target's storage when it holds the only reference;
+            // `s = s + piece` would copy all of `s` first.
+            stmt->as.reassign.appends = stmt->as.reassign.is_update &&
+                strcmp(stmt->as.reassign.value->as.binary.op.value, "+") == 0 &&
+                (type == TYPE_TEXT || type == TYPE_LIST);
+            break;
+        }
+        case STMT_WHILE:
+            expect_type(c, check_expression(c, stmt->as.while_stmt.condition), TYPE_BOOL,
+                stmt->base.line, "While condition");
+            check_body(c, stmt->as.while_stmt.body, stmt->as.while_stmt.body_count);
+            break;
+        case STMT_LOOP:
+            expect_type(c, check_expression(c, stmt->as.loop_stmt.count), TYPE_NUM,
+                stmt->base.line, "Loop count");
+            if (stmt->as.loop_stmt.parallel && c->report) {
+                check_parallel_loop(c, stmt);
+            }
+            check_body(c, stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count);
+            break;
+        case STMT_CHECK:
+            check_expression(c, stmt->as.check_stmt.subject);
+            for (int i = 0; i < stmt->as.check_stmt.case_count; i++) {
+                check_expression(c, stmt->as.check_stmt.cases[i].value);
+                check_body(c, stmt->as.check_stmt.cases[i].body, stmt->as.check_stmt.cases[i].body_count);
+            }
+            break;
+        case STMT_COMMAND_DEF:
+            if (c->report) {
+                add_command(c, stmt);
+                stmt->as.command_def.seen_before = c->seen_clock;
+            }
+            if (stmt->as.command_def.parsed) {
+                check_scope(c, stmt->as.command_def.body, stmt->as.command_def.body_count,
+                    stmt->as.command_def.params, stmt->as.command_def.param_count);
+            } else {
+                for (int i = 0; i < stmt->as.command_def.skipped_write_count; i++) {
+                    widen(c, stmt->as.command_def.skipped_writes[i]);
+                }
+            }
+            break;
+        case STMT_WRITE:
+            check_expression(c, stmt->as.write_stmt.expression);
+            break;
+        case STMT_ASK:
+            check_expression(c, stmt->as.ask_stmt.prompt);
+            assign(c, stmt->as.ask_stmt.variable.value, TYPE_TEXT, stmt->base.line);
+            mark_seen(c, stmt->as.ask_stmt.variable.value);
+            break;
+        case STMT_RETURN:
+            check_expression(c, stmt->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            check_expression(c, stmt->as.expr_stmt.expression);
+            break;
+        default:
+            break;
+    }
+}
+
+// Checks a command body built by parse_command_body against the top-level
+// scope check_types kept on the program, with the variables and commands
+// the command saw where it was defined.
+bool check_command_types(ProgramNode* program, Statement* command, const ErrorReporter* reporter) {
+    Checker checker = { .scope = NULL, .report = true, .error_count = 0, .mismatch_count = 0,
+        .commands = NULL, .command_count = 0, .command_capacity = 0, .seen_clock = 0, .reporter = reporter };
+    int count = program->checked_global_count;
+    Scope globals = { .symbols = malloc(sizeof(Symbol) * (count > 0 ? count : 1)), .count = count,
+        .capacity = count, .changed = false, .enclosing = NULL };
+    for (int i = 0; i < count; i++) {
+        CheckedGlobal* global = &program->checked_globals[i];
+        globals.symbols[i] = (Symbol){ .name = global->name, .type = global->type, .annotated = global->annotated,
+            .seen = global->seen_at >= 0 && global->seen_at < command->as.command_def.seen_before,
+            .seen_at = global->seen_at };
+    }
+    for (int i = 0; i < command->as.command_def.visible_commands; i++) {
+        add_command(&checker, program->commands[i]);
+    }
+    checker.scope = &globals;
+    check_scope(&checker, command->as.command_def.body, command->as.command_def.body_count,
+        command->as.command_def.params, command->as.command_def.param_count);
+    free(globals.symbols);
+    free(checker.commands);
+    return checker.error_count == 0;
+}
+
+bool check_types(ProgramNode* program, const ErrorReporter* reporter) {
+    Checker checker = { .scope = NULL, .report = true, .error_count = 0, .mismatch_count = 0,
+        .commands = NULL, .command_count = 0, .command_capacity = 0, .seen_clock = 0, .reporter = reporter };
+    Scope scope = { .symbols = NULL, .count = 0, .capacity = 0, .changed = false, .enclosing = NULL };
+    check_in_scope(&checker, &scope, program->statements, program->count, NULL, 0);
+
+    free(program->checked_globals);
+    program->checked_globals = malloc(sizeof(CheckedGlobal) * (scope.count > 0 ? scope.count : 1));
+    program->checked_global_count = scope.count;
+    for (int i = 0; i < scope.count; i++) {
+        Symbol* symbol = &scope.symbols[i];
+        program->checked_globals[i] = (CheckedGlobal){ .name = symbol->name, .type = symbol->type,
+            .annotated = symbol->annotated, .seen_at = symbol->seen ? symbol->seen_at : -1 };
+    }
+    free(scope.symbols);
+    free(checker.commands);
+    return checker.error_count == 0;
+}
@@ -0,0 +1,9 @@
+#ifndef CHECKER_H
+#define CHECKER_H
+
+#include "parser.h"
+
+bool check_types(ProgramNode* program, const ErrorReporter* reporter);
+bool check_command_types(ProgramNode* program, Statement* command, const ErrorReporter* reporter);
+
+#endif
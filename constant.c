@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+#include "constant.h"
+
+// Escapes and ${} interpolation are resolved when a text is evaluated, so
+// only plain text literals have a value known before the program runs.
+bool is_constant_text(const Expression* expr) {
+    if (expr == NULL || expr->type != EXPR_LITERAL || expr->as.literal.literal.type != T_STRING) return false;
+    const char* value = expr->as.literal.literal.value;
+    return strchr(value, '\\') == NULL && strstr(value, "${") == NULL;
+}
+
+static ValueType literal_type(const Expression* expr) {
+    if (expr == NULL || expr->type != EXPR_LITERAL) return TYPE_UNKNOWN;
+    switch (expr->as.literal.literal.type) {
+        case T_NUMBER: return TYPE_NUM;
+        case T_BOOL: return TYPE_BOOL;
+        case T_STRING: return is_constant_text(expr) ? TYPE_TEXT : TYPE_UNKNOWN;
+        default: return TYPE_UNKNOWN;
+    }
+}
+
+static char* copy_string(const char* value) {
+    size_t length = strlen(value);
+    char* copy = malloc(length + 1);
+    memcpy(copy, value, length + 1);
+    return copy;
+}
+
+static ListValue literal_value(const Expression* expr, ValueType type) {
+    ListValue value;
+    value.bits = 0;
+    switch (type) {
+        case TYPE_NUM: value.num = expr->as.literal.number; break;
+        case TYPE_BOOL: value.bits = strcmp(expr->as.literal.literal.value, "true") == 0; break;
+        case TYPE_TEXT: value.text = copy_string(expr->as.literal.literal.value); break;
+        default: break;
+    }
+    return value;
+}
+
+// All items must be literals of one type; TYPE_NULL stands for "no items".
+static bool uniform_type(Expression** items, int count, ValueType* type) {
+    *type = TYPE_NULL;
+    for (int i = 0; i < count; i++) {
+        ValueType item_type = literal_type(items[i]);
+        if (item_type == TYPE_UNKNOWN) return false;
+        if (i > 0 && item_type != *type) return false;
+        *type = item_type;
+    }
+    return true;
+}
+
+static void fill(FlintList* list, Expression** items, int count, ValueType type) {
+    list_reserve(list, count);
+    for (int i = 0; i < count; i++) {
+        list_append(list, literal_value(items[i], type));
+    }
+}
+
+static bool same_key(ListValue left, ListValue right, ValueType type) {
+    switch (type) {
+        case TYPE_TEXT: return strcmp(left.text, right.text) == 0;
+        case TYPE_NUM: return left.num == right.num;
+        default: return left.bits == right.bits;
+    }
+}
+
+// A repeated key keeps its first position and its last value, as it would
+// in a map built while the program runs.
+static void fill_map(FlintConstant* constant, const Expression* expr) {
+    list_reserve(&constant->keys, expr->as.map.count);
+    list_reserve(&constant->values, expr->as.map.count);
+    for (int i = 0; i < expr->as.map.count; i++) {
+        ListValue key = literal_value(expr->as.map.keys[i], constant->key_type);
+        ListValue value = literal_value(expr->as.map.values[i], constant->element_type);
+        ListValue* keys = list_items(&constant->keys);
+        int existing = -1;
+        for (int j = 0; j < constant->keys.count && existing < 0; j++) {
+            if (same_key(keys[j], key, constant->key_type)) existing = j;
+        }
+        if (existing < 0) {
+            list_append(&constant->keys, key);
+            list_append(&constant->values, value);
+            continue;
+        }
+        ListValue* values = list_items(&constant->values);
+        if (constant->key_type == TYPE_TEXT) free((char*)key.text);
+        if (constant->element_type == TYPE_TEXT) free((char*)values[existing].text);
+        values[existing] = value;
+    }
+}
+
+static void copy_list(FlintList* dest, FlintList* source, ValueType type) {
+    list_init(dest);
+    list_extend(dest, list_items(source), source->count);
+    if (type != TYPE_TEXT) return;
+    ListValue* items = list_items(dest);
+    for (int i = 0; i < dest->count; i++) {
+        items[i].text = copy_string(items[i].text);
+    }
+}
+
+static void free_list(FlintList* list, ValueType type) {
+    if (type == TYPE_TEXT) {
+        ListValue* items = list_items(list);
+        for (int i = 0; i < list->count; i++) {
+            free((char*)items[i].text);
+        }
+    }
+    list_free(list);
+}
+
+// Returns NULL unless `expr` is a list or map literal made only of
+// constant items of a single type.
+FlintConstant* constant_from_literal(const Expression* expr) {
+    ValueType key_type = TYPE_NULL;
+    ValueType element_type;
+    if (expr->type == EXPR_LIST) {
+        if (!uniform_type(expr->as.list.elements, expr->as.list.count, &element_type)) return NULL;
+    } else if (expr->type == EXPR_MAP) {
+        if (!uniform_type(expr->as.map.keys, expr->as.map.count, &key_type)) return NULL;
+        if (!uniform_type(expr->as.map.values, expr->as.map.count, &element_type)) return NULL;
+    } else {
+        return NULL;
+    }
+
+    FlintConstant* constant = malloc(sizeof(FlintConstant));
+    atomic_init(&constant->refs, 1);
+    constant->type = expr->type == EXPR_LIST ? TYPE_LIST : TYPE_MAP;
+    constant->key_type = key_type;
+    constant->element_type = element_type;
+    list_init(&constant->keys);
+    list_init(&constant->values);
+    if (expr->type == EXPR_LIST) {
+        fill(&constant->values, expr->as.list.elements, expr->as.list.count, element_type);
+    } else {
+        fill_map(constant, expr);
+    }
+    return constant;
+}
+
+FlintConstant* constant_retain(FlintConstant* constant) {
+    atomic_fetch_add(&constant->refs, 1);
+    return constant;
+}
+
+void constant_release(FlintConstant* constant) {
+    if (constant == NULL || atomic_fetch_sub(&constant->refs, 1) > 1) return;
+    free_list(&constant->keys, constant->key_type);
+    free_list(&constant->values, constant->element_type);
+    free(constant);
+}
+
+// Gives up one reference to `constant` and returns a value the caller may
+// modify: the same one if nothing else holds it, otherwise a fresh copy.
+FlintConstant* constant_make_mutable(FlintConstant* constant) {
+    if (atomic_load(&constant->refs) == 1) return constant;
+
+    FlintConstant* copy = malloc(sizeof(FlintConstant));
+    atomic_init(&copy->refs, 1);
+    copy->type = constant->type;
+    copy->key_type = constant->key_type;
+    copy->element_type = constant->element_type;
+    copy_list(&copy->keys, &constant->keys, constant->key_type);
+    copy_list(&copy->values, &constant->values, constant->element_type);
+    constant_release(constant);
+    return copy;
+}
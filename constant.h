@@ -0,0 +1,30 @@
+#ifndef CONSTANT_H
+#define CONSTANT_H
+
+#include <stdatomic.h>
+#include "parser.h"
+#include "list.h"
+
+// An immutable list or map built once, at load time, from a literal whose
+// elements are all constants. Evaluating the literal only takes another
+// reference; a holder that wants to modify its value calls
+// constant_make_mutable first, which copies only while the value is shared.
+// Maps keep keys and values as parallel lists. Texts are owned copies.
+// Pooled literals are shared by `parallel loop` workers, so the count
+// changes atomically.
+typedef struct FlintConstant {
+    atomic_int refs;
+    ValueType type;
+    ValueType key_type;
+    ValueType element_type;
+    FlintList keys;
+    FlintList values;
+} FlintConstant;
+
+bool is_constant_text(const Expression* expr);
+FlintConstant* constant_from_literal(const Expression* expr);
+FlintConstant* constant_retain(FlintConstant* constant);
+void constant_release(FlintConstant* constant);
+FlintConstant* constant_make_mutable(FlintConstant* constant);
+
+#endif
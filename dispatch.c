@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dispatch.h"
+#include "constant.h"
+
+// A jump table may have at most this many slots per `equals` arm.
+#define JUMP_TABLE_MAX_SPREAD 2
+#define JUMP_TABLE_MAX_VALUE 2147483647.0
+
+static bool is_literal_of(Expression* expr, TokenType type) {
+    return expr != NULL && expr->type == EXPR_LITERAL && expr->as.literal.literal.type == type;
+}
+
+static unsigned int hash_text(const char* text) {
+    unsigned int hash = 2166136261u;
+    for (const char* c = text; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static bool plan_jump_table(Statement* stmt) {
+    CheckCase* cases = stmt->as.check_stmt.cases;
+    int count = stmt->as.check_stmt.case_count;
+    long min = 0, max = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (!is_literal_of(cases[i].value, T_NUMBER)) return false;
+        double number = cases[i].value->as.literal.number;
+        if (number > JUMP_TABLE_MAX_VALUE || number < -JUMP_TABLE_MAX_VALUE) return false;
+        long value = (long)number;
+        if ((double)value != number) return false;
+        if (i == 0 || value < min) min = value;
+        if (i == 0 || value > max) max = value;
+    }
+
+    long spread = max - min + 1;
+    if (spread > (long)count * JUMP_TABLE_MAX_SPREAD) return false;
+
+    int* table = malloc(sizeof(int) * spread);
+    for (long i = 0; i < spread; i++) table[i] = -1;
+    for (int i = 0; i < count; i++) {
+        long slot = (long)cases[i].value->as.literal.number - min;
+        if (table[slot] != -1) {
+            free(table);
+            return false;
+        }
+        table[slot] = i;
+    }
+
+    stmt->as.check_stmt.dispatch = DISPATCH_JUMP_TABLE;
+    stmt->as.check_stmt.table = table;
+    stmt->as.check_stmt.table_size = (int)spread;
+    stmt->as.check_stmt.table_base = min;
+    return true;
+}
+
+// Open addressing with linear probing; the table is kept at most half full.
+static bool plan_hash_table(Statement* stmt) {
+    CheckCase* cases = stmt->as.check_stmt.cases;
+    int count = stmt->as.check_stmt.case_count;
+    for (int i = 0; i < count; i++) {
+        if (!is_constant_text(cases[i].value)) return false;
+    }
+
+    int size = 4;
+    while (size < count * 2) size *= 2;
+    int* table = malloc(sizeof(int) * size);
+    for (int i = 0; i < size; i++) table[i] = -1;
+
+    for (int i = 0; i < count; i++) {
+        const char* text = cases[i].value->as.literal.literal.value;
+        unsigned int slot = hash_text(text) & (size - 1);
+        while (table[slot] != -1) {
+            if (strcmp(cases[table[slot]].value->as.literal.literal.value, text) == 0) {
+                free(table);
+                return false;
+            }
+            slot = (slot + 1) & (size - 1);
+        }
+        table[slot] = i;
+    }
+
+    stmt->as.check_stmt.dispatch = DISPATCH_HASH_TABLE;
+    stmt->as.check_stmt.table = table;
+    stmt->as.check_stmt.table_size = size;
+    stmt->as.check_stmt.table_base = 0;
+    return true;
+}
+
+// Picks how a `check` block selects its arm. Distinct, dense integral num
+// arms get a jump table, distinct text arms a hash table, and anything else
+// (non-constant or duplicate arms) keeps the sequential comparison chain.
+void plan_check_dispatch(Statement* stmt) {
+    stmt->as.check_stmt.dispatch = DISPATCH_CHAIN;
+    stmt->as.check_stmt.table = NULL;
+    stmt->as.check_stmt.table_size = 0;
+    stmt->as.check_stmt.table_base = 0;
+    if (stmt->as.check_stmt.case_count == 0) return;
+    if (plan_jump_table(stmt)) return;
+    plan_hash_table(stmt);
+}
+
+// Returns the index of the arm matching `value`, or -1 if none does.
+// Only valid for DISPATCH_JUMP_TABLE blocks.
+int find_check_case_num(Statement* stmt, double value) {
+    if (value > JUMP_TABLE_MAX_VALUE || value < -JUMP_TABLE_MAX_VALUE) return -1;
+    long integral = (long)value;
+    if ((double)integral != value) return -1;
+    long slot = integral - stmt->as.check_stmt.table_base;
+    if (slot < 0 || slot >= stmt->as.check_stmt.table_size) return -1;
+    return stmt->as.check_stmt.table[slot];
+}
+
+// Returns the index of the arm matching `value`, or -1 if none does.
+// Only valid for DISPATCH_HASH_TABLE blocks.
+int find_check_case_text(Statement* stmt, const char* value) {
+    int* table = stmt->as.check_stmt.table;
+    int mask = stmt->as.check_stmt.table_size - 1;
+    unsigned int slot = hash_text(value) & mask;
+    while (table[slot] != -1) {
+        if (strcmp(stmt->as.check_stmt.cases[table[slot]].value->as.literal.literal.value, value) == 0) {
+            return table[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+void free_check_dispatch(Statement* stmt) {
+    free(stmt->as.check_stmt.table);
+    stmt->as.check_stmt.table = NULL;
+}
+
+const char* check_dispatch_to_string(CheckDispatch dispatch) {
+    switch (dispatch) {
+        case DISPATCH_CHAIN: return "chain";
+        case DISPATCH_JUMP_TABLE: return "jump table";
+        case DISPATCH_HASH_TABLE: return "hash table";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "parser.h"
+
+void plan_check_dispatch(Statement* stmt);
+int find_check_case_num(Statement* stmt, double value);
+int find_check_case_text(Statement* stmt, const char* value);
+void free_check_dispatch(Statement* stmt);
+const char* check_dispatch_to_string(CheckDispatch dispatch);
+
+#endif
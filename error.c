@@ -0,0 +1,17 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include "error.h"
+
+void report_error(const ErrorReporter* reporter, const char* format, ...) {
+    char message[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    if (reporter == NULL || reporter->report == NULL) {
+        fprintf(stderr, "%s\n", message);
+        return;
+    }
+    reporter->report(reporter->user_data, message);
+}
@@ -0,0 +1,15 @@
+#ifndef ERROR_H
+#define ERROR_H
+
+typedef void (*ErrorFn)(void* user_data, const char* message);
+
+// Where the front end sends its diagnostics. A NULL reporter, or one with
+// no callback, writes them to stderr.
+typedef struct {
+    ErrorFn report;
+    void* user_data;
+} ErrorReporter;
+
+void report_error(const ErrorReporter* reporter, const char* format, ...);
+
+#endif
@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "flint.h"
+#include "tokenizer.h"
+#include "resolver.h"
+#include "checker.h"
+
+struct FlintVM {
+    ErrorReporter reporter;
+    Token* tokens;
+    int token_count;
+    ProgramNode* program;
+    char* source;
+    bool lazy_parsing;
+    bool loaded_lazy;
+};
+
+struct FlintPool {
+    pthread_mutex_t lock;
+    ErrorReporter reporter;
+    FlintVM** idle;
+    int idle_count;
+    int capacity;
+};
+
+FlintVM* flint_vm_new(const ErrorReporter* reporter) {
+    FlintVM* vm = malloc(sizeof(FlintVM));
+    if (vm == NULL) return NULL;
+    vm->reporter.report = reporter ? reporter->report : NULL;
+    vm->reporter.user_data = reporter ? reporter->user_data : NULL;
+    vm->tokens = NULL;
+    vm->token_count = 0;
+    vm->program = NULL;
+    vm->source = NULL;
+    vm->lazy_parsing = false;
+    vm->loaded_lazy = false;
+    return vm;
+}
+
+// With lazy parsing, command bodies are only parsed and checked when
+// flint_prepare_command is first called for them, so startup cost follows
+// the size of the top-level code rather than of the whole file.
+void flint_set_lazy_parsing(FlintVM* vm, bool lazy) {
+    vm->lazy_parsing = lazy;
+}
+
+void flint_vm_free(FlintVM* vm) {
+    if (vm == NULL) return;
+    flint_reset(vm);
+    free(vm);
+}
+
+// Drops the loaded program so the VM can load another one.
+void flint_reset(FlintVM* vm) {
+    free_ast((AstNode*)vm->program);
+    free_tokens(vm->tokens, vm->token_count);
+    free(vm->source);
+    vm->program = NULL;
+    vm->tokens = NULL;
+    vm->token_count = 0;
+    vm->source = NULL;
+}
+
+// Loading the source the VM already holds, with the same lazy setting,
+// keeps the checked program, so a pooled VM serving the same script again
+// only pays for a comparison.
+FlintResult flint_load(FlintVM* vm, const char* source) {
+    if (vm->program != NULL && vm->loaded_lazy == vm->lazy_parsing && strcmp(vm->source, source) == 0) {
+        return FLINT_OK;
+    }
+    flint_reset(vm);
+
+    vm->tokens = tokenize(source, &vm->token_count, &vm->reporter);
+    if (vm->tokens == NULL) {
+        vm->token_count = 0;
+        return FLINT_SYNTAX_ERROR;
+    }
+
+    vm->program = parse(vm->tokens, vm->token_count, vm->lazy_parsing, &vm->reporter);
+    if (vm->program == NULL) {
+        flint_reset(vm);
+        return FLINT_SYNTAX_ERROR;
+    }
+
+    if (!resolve_program(vm->program, &vm->reporter)) {
+        flint_reset(vm);
+        return FLINT_NAME_ERROR;
+    }
+
+    if (!check_types(vm->program, &vm->reporter)) {
+        flint_reset(vm);
+        return FLINT_TYPE_ERROR;
+    }
+
+    // Bodies parsed so far were resolved and checked with the program.
+    for (int i = 0; i < vm->program->command_count; i++) {
+        Statement* command = vm->program->commands[i];
+        command->as.command_def.prepared = command->as.command_def.parsed;
+    }
+
+    size_t length = strlen(source);
+    vm->source = malloc(length + 1);
+    memcpy(vm->source, source, length + 1);
+    vm->loaded_lazy = vm->lazy_parsing;
+    return FLINT_OK;
+}
+
+// Makes sure the body of the top-level command `name` is parsed and
+// checked; call before its first execution. Errors in the body are reported
+// by the first call and recorded on the command, so later calls return the
+// same result.
+FlintResult flint_prepare_command(FlintVM* vm, const char* name) {
+    Statement* command = NULL;
+    int count = vm->program != NULL ? vm->program->command_count : 0;
+    for (int i = count - 1; i >= 0; i--) {
+        if (strcmp(vm->program->commands[i]->as.command_def.name.value, name) == 0) {
+            command = vm->program->commands[i];
+            break;
+        }
+    }
+    if (command == NULL) {
+        report_error(&vm->reporter, "NameError: Undefined command '%s'.", name);
+        return FLINT_NAME_ERROR;
+    }
+    if (command->as.command_def.prepared) return (FlintResult)command->as.command_def.prepare_result;
+    FlintResult result = FLINT_OK;
+    if (!parse_command_body(vm->program, vm->tokens, command, &vm->reporter)) {
+        result = FLINT_SYNTAX_ERROR;
+    } else if (!resolve_command(vm->program, command, &vm->reporter)) {
+        result = FLINT_NAME_ERROR;
+    } else if (!check_command_types(vm->program, command, &vm->reporter)) {
+        result = FLINT_TYPE_ERROR;
+    }
+    command->as.command_def.prepared = true;
+    command->as.command_def.prepare_result = result;
+    return result;
+}
+
+const ProgramNode* flint_program(const FlintVM* vm) {
+    return vm->program;
+}
+
+FlintPool* flint_pool_new(int size, const ErrorReporter* reporter) {
+    FlintPool* pool = malloc(sizeof(FlintPool));
+    if (pool == NULL) return NULL;
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->reporter.report = reporter ? reporter->report : NULL;
+    pool->reporter.user_data = reporter ? reporter->user_data : NULL;
+    pool->capacity = size > 0 ? size : 4;
+    pool->idle = malloc(sizeof(FlintVM*) * pool->capacity);
+    pool->idle_count = 0;
+    for (int i = 0; i < size; i++) {
+        FlintVM* vm = flint_vm_new(&pool->reporter);
+        if (vm == NULL) break;
+        pool->idle[pool->idle_count++] = vm;
+    }
+    return pool;
+}
+
+// Hands out an idle VM, or a new one when every pooled VM is in use.
+FlintVM* flint_pool_acquire(FlintPool* pool) {
+    FlintVM* vm = NULL;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->idle_count > 0) {
+        vm = pool->idle[--pool->idle_count];
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return vm ? vm : flint_vm_new(&pool->reporter);
+}
+
+// The VM keeps its loaded program, so the next flint_load of the same
+// source on it returns at once.
+void flint_pool_release(FlintPool* pool, FlintVM* vm) {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->idle_count >= pool->capacity) {
+        pool->capacity *= 2;
+        pool->idle = realloc(pool->idle, sizeof(FlintVM*) * pool->capacity);
+    }
+    pool->idle[pool->idle_count++] = vm;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Frees the pool and its idle VMs. VMs still acquired must be freed by
+// their owner with flint_vm_free.
+void flint_pool_free(FlintPool* pool) {
+    if (pool == NULL) return;
+    for (int i = 0; i < pool->idle_count; i++) {
+        flint_vm_free(pool->idle[i]);
+    }
+    free(pool->idle);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
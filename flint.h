@@ -0,0 +1,34 @@
+#ifndef FLINT_H
+#define FLINT_H
+
+#include "error.h"
+#include "parser.h"
+
+// Embedding API. A FlintVM owns one loaded program and no state is shared
+// between VMs, so separate VMs can be used from separate threads. Errors
+// go to the VM's ErrorReporter and are returned as a FlintResult.
+
+typedef struct FlintVM FlintVM;
+typedef struct FlintPool FlintPool;
+
+typedef enum {
+    FLINT_OK,
+    FLINT_SYNTAX_ERROR,
+    FLINT_NAME_ERROR,
+    FLINT_TYPE_ERROR
+} FlintResult;
+
+FlintVM* flint_vm_new(const ErrorReporter* reporter);
+void flint_vm_free(FlintVM* vm);
+void flint_set_lazy_parsing(FlintVM* vm, bool lazy);
+FlintResult flint_load(FlintVM* vm, const char* source);
+FlintResult flint_prepare_command(FlintVM* vm, const char* name);
+const ProgramNode* flint_program(const FlintVM* vm);
+void flint_reset(FlintVM* vm);
+
+FlintPool* flint_pool_new(int size, const ErrorReporter* reporter);
+FlintVM* flint_pool_acquire(FlintPool* pool);
+void flint_pool_release(FlintPool* pool, FlintVM* vm);
+void flint_pool_free(FlintPool* pool);
+
+#endif
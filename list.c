@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "list.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static bool is_inline(const FlintList* list) {
+    return list->capacity <= LIST_INLINE_CAPACITY;
+}
+
+static const ListValue* const_items(const FlintList* list) {
+    return is_inline(list) ? list->storage.inline_items : list->storage.heap;
+}
+
+void list_init(FlintList* list) {
+    list->count = 0;
+    list->capacity = LIST_INLINE_CAPACITY;
+}
+
+void list_free(FlintList* list) {
+    if (!is_inline(list)) {
+        free(list->storage.heap);
+    }
+    list_init(list);
+}
+
+ListValue* list_items(FlintList* list) {
+    return is_inline(list) ? list->storage.inline_items : list->storage.heap;
+}
+
+void list_reserve(FlintList* list, int capacity) {
+    if (capacity <= list->capacity) return;
+
+    int new_capacity = list->capacity * 2;
+    if (new_capacity < capacity) new_capacity = capacity;
+
+    if (is_inline(list)) {
+        ListValue* heap = malloc(sizeof(ListValue) * new_capacity);
+        memcpy(heap, list->storage.inline_items, sizeof(ListValue) * list->count);
+        list->storage.heap = heap;
+    } else {
+        list->storage.heap = realloc(list->storage.heap, sizeof(ListValue) * new_capacity);
+    }
+    list->capacity = new_capacity;
+}
+
+void list_append(FlintList* list, ListValue value) {
+    if (list->count >= list->capacity) {
+        list_reserve(list, list->count + 1);
+    }
+    list_items(list)[list->count++] = value;
+}
+
+void list_extend(FlintList* list, const ListValue* values, int count) {
+    if (count <= 0) return;
+    // `values` may be the list's own items (`xs + xs`), which reserving
+    // can move, so remember where they were relative to the storage.
+    const ListValue* items = list_items(list);
+    bool aliased = values >= items && values < items + list->count;
+    ptrdiff_t offset = values - items;
+    list_reserve(list, list->count + count);
+    if (aliased) values = list_items(list) + offset;
+    memcpy(list_items(list) + list->count, values, sizeof(ListValue) * count);
+    list->count += count;
+}
+
+bool list_contains_num(const FlintList* list, double value) {
+    const ListValue* items = const_items(list);
+    int i = 0;
+#if defined(__SSE2__)
+    __m128d needle = _mm_set1_pd(value);
+    for (; i + 4 <= list->count; i += 4) {
+        __m128d lo = _mm_cmpeq_pd(_mm_loadu_pd(&items[i].num), needle);
+        __m128d hi = _mm_cmpeq_pd(_mm_loadu_pd(&items[i + 2].num), needle);
+        if (_mm_movemask_pd(_mm_or_pd(lo, hi)) != 0) return true;
+    }
+#endif
+    for (; i < list->count; i++) {
+        if (items[i].num == value) return true;
+    }
+    return false;
+}
+
+// Text shared with the list (the usual case for literals and variables) is
+// found by pointer alone; only a miss falls back to comparing contents.
+bool list_contains_text(const FlintList* list, const char* value) {
+    const ListValue* items = const_items(list);
+    for (int i = 0; i < list->count; i++) {
+        if (items[i].text == value) return true;
+    }
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(items[i].text, value) == 0) return true;
+    }
+    return false;
+}
@@ -0,0 +1,35 @@
+#ifndef LIST_H
+#define LIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LIST_INLINE_CAPACITY 4
+
+typedef union {
+    double num;
+    const char* text;
+    uint64_t bits;
+} ListValue;
+
+// A growable contiguous vector of 64-bit values. Lists of up to
+// LIST_INLINE_CAPACITY items live inside the struct with no heap block.
+typedef struct {
+    int count;
+    int capacity;
+    union {
+        ListValue* heap;
+        ListValue inline_items[LIST_INLINE_CAPACITY];
+    } storage;
+} FlintList;
+
+void list_init(FlintList* list);
+void list_free(FlintList* list);
+ListValue* list_items(FlintList* list);
+void list_reserve(FlintList* list, int capacity);
+void list_append(FlintList* list, ListValue value);
+void list_extend(FlintList* list, const ListValue* values, int count);
+bool list_contains_num(const FlintList* list, double value);
+bool list_contains_text(const FlintList* list, const char* value);
+
+#endif
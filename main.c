@@ -1,8 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "tokenizer.h"
-#include "parser.h"
+#include "flint.h"
 
 
 int main(int argc, char *argv[]) {
@@ -35,25 +34,24 @@ int main(int argc, char *argv[]) {
     buffer[filesize] = '\0';
     fclose(file);
 
-    int token_count = 0;
-    Token *tokens = tokenize(buffer, &token_count);
-    free(buffer);
-
-    if (tokens == NULL) {
+    FlintVM* vm = flint_vm_new(NULL);
+    if (!vm) {
+        fprintf(stderr, "Error: Memory allocation failed.\n");
+        free(buffer);
         return 1;
     }
+    FlintResult result = flint_load(vm, buffer);
+    free(buffer);
 
-    ProgramNode* ast = parse(tokens, token_count);
-    if (ast == NULL) {
-        free_tokens(tokens, token_count);
+    if (result != FLINT_OK) {
+        flint_vm_free(vm);
         return 1;
     }
 
     printf("Parsing successful!\n");
-    print_ast((AstNode*)ast);
+    print_ast((AstNode*)flint_program(vm));
 
-    free_ast((AstNode*)ast);
-    free_tokens(tokens, token_count);
+    flint_vm_free(vm);
 
     return 0;
 }
@@ -0,0 +1,418 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "number.h"
+
+#define MAX_EXACT_INT 9007199254740992.0   // 2^53
+#define MAX_EXACT_MANTISSA (1ull << 53)
+#define MAX_EXACT_POW10 22
+#define MAX_FAST_DIGITS 19
+
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool parse_slow(const char* text, size_t length, double* out) {
+    char stack_copy[64];
+    char* copy = length < sizeof(stack_copy) ? stack_copy : malloc(length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    *out = strtod(copy, NULL);
+    if (copy != stack_copy) free(copy);
+    return true;
+}
+
+// Parses `[+-]digits[.digits][(e|E)[+-]digits]`. When the digits fit in 53
+// bits and the power of ten is exactly representable (Clinger's fast path)
+// the result is one correctly rounded multiply or divide; everything else
+// goes through strtod.
+bool parse_num(const char* text, size_t length, double* out) {
+    const char* p = text;
+    const char* end = text + length;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any_digits = false;
+
+    while (p < end && *p == '0') {
+        p++;
+        any_digits = true;
+    }
+    for (; p < end && is_digit(*p); p++, any_digits = true) {
+        if (digits < MAX_FAST_DIGITS) mantissa = mantissa * 10 + (*p - '0');
+        else exponent++;
+        digits++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        if (digits == 0) {
+            while (p < end && *p == '0') {
+                p++;
+                exponent--;
+                any_digits = true;
+            }
+        }
+        for (; p < end && is_digit(*p); p++, any_digits = true) {
+            if (digits < MAX_FAST_DIGITS) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+            digits++;
+        }
+    }
+    if (!any_digits) return false;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool exponent_negative = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            exponent_negative = *p == '-';
+            p++;
+        }
+        if (p == end || !is_digit(*p)) return false;
+        int explicit_exponent = 0;
+        for (; p < end && is_digit(*p); p++) {
+            if (explicit_exponent < 100000) explicit_exponent = explicit_exponent * 10 + (*p - '0');
+        }
+        exponent += exponent_negative ? -explicit_exponent : explicit_exponent;
+    }
+    if (p != end) return false;
+
+    if (digits > MAX_FAST_DIGITS || mantissa > MAX_EXACT_MANTISSA) {
+        return parse_slow(text, length, out);
+    }
+
+    double value = (double)mantissa;
+    if (mantissa == 0) {
+        value = 0;
+    } else if (exponent < 0 && exponent >= -MAX_EXACT_POW10) {
+        value /= powers_of_ten[-exponent];
+    } else if (exponent >= 0 && exponent <= MAX_EXACT_POW10) {
+        value *= powers_of_ten[exponent];
+    } else if (exponent > MAX_EXACT_POW10 && exponent <= MAX_EXACT_POW10 + 15 &&
+               value * powers_of_ten[exponent - MAX_EXACT_POW10] <= MAX_EXACT_INT) {
+        value = value * powers_of_ten[exponent - MAX_EXACT_POW10] * powers_of_ten[MAX_EXACT_POW10];
+    } else {
+        return parse_slow(text, length, out);
+    }
+    *out = negative ? -value : value;
+    return true;
+}
+
+static int write_integer(uint64_t value, char* buffer) {
+    char digits[24];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (int i = 0; i < count; i++) {
+        buffer[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+// Shortest digits come from Grisu3 (Loitsch, "Printing Floating-Point
+// Numbers Quickly and Accurately with Integers"): the value and the
+// midpoints to its neighbours are scaled by a cached power of ten into
+// 64-bit fixed point, and digits are generated until they fall strictly
+// between the midpoints. It gives up on about 0.5% of values, where the
+// 64-bit approximation can't tell which candidate is right.
+typedef struct {
+    uint64_t f;
+    int e;
+} DiyFp;
+
+#define CACHED_POWERS_MIN_EXPONENT -348
+#define CACHED_POWERS_STEP 8
+#define CACHED_POWERS_COUNT 87
+
+// 10^k for k = -348, -340, ..., 340, as normalized significand and binary
+// exponent.
+static const DiyFp cached_powers[CACHED_POWERS_COUNT] = {
+    { 0xfa8fd5a0081c0288ull, -1220 }, { 0xbaaee17fa23ebf76ull, -1193 }, { 0x8b16fb203055ac76ull, -1166 },
+    { 0xcf42894a5dce35eaull, -1140 }, { 0x9a6bb0aa55653b2dull, -1113 }, { 0xe61acf033d1a45dfull, -1087 },
+    { 0xab70fe17c79ac6caull, -1060 }, { 0xff77b1fcbebcdc4full, -1034 }, { 0xbe5691ef416bd60cull, -1007 },
+    { 0x8dd01fad907ffc3cull, -980 }, { 0xd3515c2831559a83ull, -954 }, { 0x9d71ac8fada6c9b5ull, -927 },
+    { 0xea9c227723ee8bcbull, -901 }, { 0xaecc49914078536dull, -874 }, { 0x823c12795db6ce57ull, -847 },
+    { 0xc21094364dfb5637ull, -821 }, { 0x9096ea6f3848984full, -794 }, { 0xd77485cb25823ac7ull, -768 },
+    { 0xa086cfcd97bf97f4ull, -741 }, { 0xef340a98172aace5ull, -715 }, { 0xb23867fb2a35b28eull, -688 },
+    { 0x84c8d4dfd2c63f3bull, -661 }, { 0xc5dd44271ad3cdbaull, -635 }, { 0x936b9fcebb25c996ull, -608 },
+    { 0xdbac6c247d62a584ull, -582 }, { 0xa3ab66580d5fdaf6ull, -555 }, { 0xf3e2f893dec3f126ull, -529 },
+    { 0xb5b5ada8aaff80b8ull, -502 }, { 0x87625f056c7c4a8bull, -475 }, { 0xc9bcff6034c13053ull, -449 },
+    { 0x964e858c91ba2655ull, -422 }, { 0xdff9772470297ebdull, -396 }, { 0xa6dfbd9fb8e5b88full, -369 },
+    { 0xf8a95fcf88747d94ull, -343 }, { 0xb94470938fa89bcfull, -316 }, { 0x8a08f0f8bf0f156bull, -289 },
+    { 0xcdb02555653131b6ull, -263 }, { 0x993fe2c6d07b7facull, -236 }, { 0xe45c10c42a2b3b06ull, -210 },
+    { 0xaa242499697392d3ull, -183 }, { 0xfd87b5f28300ca0eull, -157 }, { 0xbce5086492111aebull, -130 },
+    { 0x8cbccc096f5088ccull, -103 }, { 0xd1b71758e219652cull, -77 }, { 0x9c40000000000000ull, -50 },
+    { 0xe8d4a51000000000ull, -24 }, { 0xad78ebc5ac620000ull, 3 }, { 0x813f3978f8940984ull, 30 },
+    { 0xc097ce7bc90715b3ull, 56 }, { 0x8f7e32ce7bea5c70ull, 83 }, { 0xd5d238a4abe98068ull, 109 },
+    { 0x9f4f2726179a2245ull, 136 }, { 0xed63a231d4c4fb27ull, 162 }, { 0xb0de65388cc8ada8ull, 189 },
+    { 0x83c7088e1aab65dbull, 216 }, { 0xc45d1df942711d9aull, 242 }, { 0x924d692ca61be758ull, 269 },
+    { 0xda01ee641a708deaull, 295 }, { 0xa26da3999aef774aull, 322 }, { 0xf209787bb47d6b85ull, 348 },
+    { 0xb454e4a179dd1877ull, 375 }, { 0x865b86925b9bc5c2ull, 402 }, { 0xc83553c5c8965d3dull, 428 },
+    { 0x952ab45cfa97a0b3ull, 455 }, { 0xde469fbd99a05fe3ull, 481 }, { 0xa59bc234db398c25ull, 508 },
+    { 0xf6c69a72a3989f5cull, 534 }, { 0xb7dcbf5354e9beceull, 561 }, { 0x88fcf317f22241e2ull, 588 },
+    { 0xcc20ce9bd35c78a5ull, 614 }, { 0x98165af37b2153dfull, 641 }, { 0xe2a0b5dc971f303aull, 667 },
+    { 0xa8d9d1535ce3b396ull, 694 }, { 0xfb9b7cd9a4a7443cull, 720 }, { 0xbb764c4ca7a44410ull, 747 },
+    { 0x8bab8eefb6409c1aull, 774 }, { 0xd01fef10a657842cull, 800 }, { 0x9b10a4e5e9913129ull, 827 },
+    { 0xe7109bfba19c0c9dull, 853 }, { 0xac2820d9623bf429ull, 880 }, { 0x80444b5e7aa7cf85ull, 907 },
+    { 0xbf21e44003acdd2dull, 933 }, { 0x8e679c2f5e44ff8full, 960 }, { 0xd433179d9c8cb841ull, 986 },
+    { 0x9e19db92b4e31ba9ull, 1013 }, { 0xeb96bf6ebadf77d9ull, 1039 }, { 0xaf87023b9bf0ee6bull, 1066 },
+};
+
+static DiyFp diy_normalize(DiyFp x) {
+    while (!(x.f & (1ull << 63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+// The upper 64 bits of the 128-bit product, rounded.
+static DiyFp diy_multiply(DiyFp a, DiyFp b) {
+    const uint64_t mask = 0xffffffffu;
+    uint64_t a_high = a.f >> 32, a_low = a.f & mask;
+    uint64_t b_high = b.f >> 32, b_low = b.f & mask;
+    uint64_t high_high = a_high * b_high;
+    uint64_t low_high = a_low * b_high;
+    uint64_t high_low = a_high * b_low;
+    uint64_t low_low = a_low * b_low;
+    uint64_t middle = (low_low >> 32) + (high_low & mask) + (low_high & mask) + (1u << 31);
+    DiyFp result = { high_high + (high_low >> 32) + (low_high >> 32) + (middle >> 32), a.e + b.e + 64 };
+    return result;
+}
+
+// Moves the last digit down towards the value while that keeps it inside
+// the interval, then reports whether the result is certainly the closest
+// shortest candidate.
+static bool round_weed(char* digits, int count, uint64_t distance_too_high_w, uint64_t unsafe_interval,
+                       uint64_t rest, uint64_t ten_kappa, uint64_t unit) {
+    uint64_t small_distance = distance_too_high_w - unit;
+    uint64_t big_distance = distance_too_high_w + unit;
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance)) {
+        digits[count - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance)) {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+// `low`, `w` and `high` share an exponent in [-60, -32], so the integral
+// part fits in 32 bits.
+static bool digit_gen(DiyFp low, DiyFp w, DiyFp high, char* digits, int* count, int* kappa) {
+    uint64_t unit = 1;
+    DiyFp too_low = { low.f - unit, low.e };
+    DiyFp too_high = { high.f + unit, high.e };
+    uint64_t unsafe_interval = too_high.f - too_low.f;
+    int shift = -w.e;
+    uint64_t one = 1ull << shift;
+    uint32_t integrals = (uint32_t)(too_high.f >> shift);
+    uint64_t fractionals = too_high.f & (one - 1);
+
+    uint32_t divisor = 1;
+    *kappa = 0;
+    if (integrals != 0) {
+        *kappa = 1;
+        while ((uint64_t)divisor * 10 <= integrals) {
+            divisor *= 10;
+            (*kappa)++;
+        }
+    }
+
+    *count = 0;
+    while (*kappa > 0) {
+        digits[(*count)++] = (char)('0' + integrals / divisor);
+        integrals %= divisor;
+        (*kappa)--;
+        uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+        if (rest < unsafe_interval) {
+            return round_weed(digits, *count, too_high.f - w.f, unsafe_interval, rest,
+                (uint64_t)divisor << shift, unit);
+        }
+        divisor /= 10;
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        digits[(*count)++] = (char)('0' + (fractionals >> shift));
+        fractionals &= one - 1;
+        (*kappa)--;
+        if (fractionals < unsafe_interval) {
+            return round_weed(digits, *count, (too_high.f - w.f) * unit, unsafe_interval, fractionals, one, unit);
+        }
+    }
+}
+
+// Writes the shortest digits of a positive finite `value`, with `exponent`
+// the power of ten of the first one. Returns false when Grisu can't decide.
+static bool shortest_digits(double value, char* digits, int* count, int* exponent) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint64_t significand = bits & ((1ull << 52) - 1);
+    int biased_exponent = (int)(bits >> 52);
+    DiyFp v;
+    if (biased_exponent != 0) {
+        v.f = significand | (1ull << 52);
+        v.e = biased_exponent - 1075;
+    } else {
+        v.f = significand;
+        v.e = -1074;
+    }
+
+    // The boundaries are the midpoints to the neighbouring doubles; below a
+    // power of two the lower neighbour is twice as close.
+    DiyFp plus = diy_normalize((DiyFp){ (v.f << 1) + 1, v.e - 1 });
+    DiyFp minus = significand == 0 && biased_exponent > 1
+        ? (DiyFp){ (v.f << 2) - 1, v.e - 2 }
+        : (DiyFp){ (v.f << 1) - 1, v.e - 1 };
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    DiyFp w = diy_normalize(v);
+
+    // Pick the cached power that brings the exponent into [-60, -32].
+    int index = (int)((-plus.e - 47) * 0.30102999566398114 - CACHED_POWERS_MIN_EXPONENT) / CACHED_POWERS_STEP;
+    if (index < 0) index = 0;
+    if (index >= CACHED_POWERS_COUNT) index = CACHED_POWERS_COUNT - 1;
+    while (index > 0 && cached_powers[index].e + plus.e + 64 > -32) index--;
+    while (index < CACHED_POWERS_COUNT - 1 && cached_powers[index].e + plus.e + 64 < -60) index++;
+    DiyFp power = cached_powers[index];
+    int power_exponent = CACHED_POWERS_MIN_EXPONENT + index * CACHED_POWERS_STEP;
+
+    int kappa;
+    if (!digit_gen(diy_multiply(minus, power), diy_multiply(w, power), diy_multiply(plus, power),
+                   digits, count, &kappa)) {
+        return false;
+    }
+    while (*count > 1 && digits[*count - 1] == '0') {
+        (*count)--;
+        kappa++;
+    }
+    *exponent = kappa - power_exponent + *count - 1;
+    return true;
+}
+
+// Lays out digits the way "%.<count>g" does, so values that fall through
+// to here print as they always have.
+static int write_digits(const char* digits, int count, int exponent, char* buffer) {
+    int length = 0;
+    if (exponent < -4 || exponent >= count) {
+        buffer[length++] = digits[0];
+        if (count > 1) {
+            buffer[length++] = '.';
+            memcpy(buffer + length, digits + 1, count - 1);
+            length += count - 1;
+        }
+        length += sprintf(buffer + length, "e%c%02d", exponent < 0 ? '-' : '+', exponent < 0 ? -exponent : exponent);
+    } else if (exponent < 0) {
+        buffer[length++] = '0';
+        buffer[length++] = '.';
+        for (int i = -1; i > exponent; i--) buffer[length++] = '0';
+        memcpy(buffer + length, digits, count);
+        length += count;
+    } else {
+        memcpy(buffer + length, digits, exponent + 1);
+        length += exponent + 1;
+        if (count > exponent + 1) {
+            buffer[length++] = '.';
+            memcpy(buffer + length, digits + exponent + 1, count - exponent - 1);
+            length += count - exponent - 1;
+        }
+    }
+    return length;
+}
+
+// Formats `value` with the fewest significant digits that parse back to
+// the same num. Integral nums print without a fraction ("5", not "5.0").
+int format_num(double value, char* buffer) {
+    if (value != value) return sprintf(buffer, "nan");
+    if (value > 1.7976931348623157e308) return sprintf(buffer, "inf");
+    if (value < -1.7976931348623157e308) return sprintf(buffer, "-inf");
+
+    int length = 0;
+    double magnitude = value;
+    if (value < 0) {
+        buffer[length++] = '-';
+        magnitude = -value;
+    }
+    if (magnitude == 0) {
+        buffer[0] = '0';
+        buffer[1] = '\0';
+        return 1;
+    }
+
+    if (magnitude < MAX_EXACT_INT && magnitude == (double)(uint64_t)magnitude) {
+        length += write_integer((uint64_t)magnitude, buffer + length);
+        buffer[length] = '\0';
+        return length;
+    }
+
+    // Short decimals: the smallest k for which round(v * 10^k) / 10^k == v
+    // gives the shortest digits, and that division is exact by the same
+    // argument as parse_num's fast path.
+    if (magnitude >= 1e-6 && magnitude < 1e15) {
+        for (int k = 1; k <= MAX_EXACT_POW10; k++) {
+            double scaled = magnitude * powers_of_ten[k];
+            if (scaled >= MAX_EXACT_INT) break;
+            uint64_t candidate = (uint64_t)(scaled + 0.5);
+            if ((double)candidate / powers_of_ten[k] != magnitude) continue;
+
+            char digits[24];
+            int count = write_integer(candidate, digits);
+            if (count <= k) {
+                buffer[length++] = '0';
+                buffer[length++] = '.';
+                for (int i = count; i < k; i++) buffer[length++] = '0';
+                memcpy(buffer + length, digits, count);
+                length += count;
+            } else {
+                memcpy(buffer + length, digits, count - k);
+                length += count - k;
+                buffer[length++] = '.';
+                memcpy(buffer + length, digits + count - k, k);
+                length += k;
+            }
+            buffer[length] = '\0';
+            return length;
+        }
+    }
+
+    char digits[24];
+    int count;
+    int exponent;
+    if (shortest_digits(magnitude, digits, &count, &exponent)) {
+        length += write_digits(digits, count, exponent, buffer + length);
+        buffer[length] = '\0';
+        return length;
+    }
+
+    // Grisu couldn't prove its digits shortest. Output that round-trips at
+    // one precision also does at every higher one, so a binary search
+    // finds the shortest; 17 significant digits always round-trip.
+    int low = 1;
+    int high = 17;
+    while (low < high) {
+        int precision = (low + high) / 2;
+        int written = snprintf(buffer, NUM_BUFFER_SIZE, "%.*g", precision, value);
+        if (written < NUM_BUFFER_SIZE && strtod(buffer, NULL) == value) high = precision;
+        else low = precision + 1;
+    }
+    return snprintf(buffer, NUM_BUFFER_SIZE, "%.*g", low, value);
+}
@@ -0,0 +1,13 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Large enough for any num formatted by format_num, including the NUL.
+#define NUM_BUFFER_SIZE 32
+
+bool parse_num(const char* text, size_t length, double* out);
+int format_num(double value, char* buffer);
+
+#endif
@@ -3,17 +3,48 @@
 #include <string.h>
 #include <stdarg.h>
 #include "parser.h"
+#include "dispatch.h"
+#include "number.h"
+#include "constant.h"
+
+#define INLINE_MAX_STATEMENTS 3
 
 typedef struct {
     Token* tokens;
     int count;
     int current;
+    Statement** commands;
+    int command_count;
+    int command_capacity;
+    Statement** outer_commands;
+    int outer_count;
+    int command_depth;
+    int parallel_depth;
+    bool lazy_commands;
+    const ErrorReporter* reporter;
+    bool had_error;
 } Parser;
 
 static Statement* parse_statement(Parser* p);
 static Expression* parse_expression(Parser* p);
 static void print_statement(Statement* stmt, int indent);
 static void print_expression(Expression* expr, int indent);
+void free_expression(Expression* expr);
+static void free_body(Statement** body, int count);
+
+// Reports the first error only; once had_error is set every parse loop
+// stops, and parse() frees whatever was built and returns NULL.
+static void parser_error(Parser* p, const char* format, ...) {
+    if (p->had_error) return;
+    p->had_error = true;
+
+    char message[400];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    report_error(p->reporter, "%s", message);
+}
 
 static void advance(Parser* p) {
     if (p->current < p->count) {
@@ -58,10 +89,10 @@ static Token consume(Parser* p, TokenType type, const char* message) {
         advance(p);
         return t;
     }
-    fprintf(stderr, "ParseError on line %d: %s. Expected %s, got %s.\n",
+    parser_error(p, "ParseError on line %d: %s. Expected %s, got %s.",
         current_token(p).line, message,
         token_type_to_string(type), token_type_to_string(current_token(p).type));
-    exit(1);
+    return current_token(p);
 }
 
 typedef enum {
@@ -93,23 +124,26 @@ static Expression* unary(Parser* p);
 static Expression* binary(Parser* p, Expression* left);
 static Expression* call(Parser* p, Expression* left);
 static Expression* get(Parser* p, Expression* left);
+static Expression* list_literal(Parser* p);
+static Expression* map_literal(Parser* p);
 static Expression* parse_precedence(Parser* p, Precedence precedence);
+static void resolve_command_call(Parser* p, Expression* call_expr);
 
-static ParseRule* get_rule(Parser* p, TokenType type);
+static const ParseRule* get_rule(Token token);
 
-ParseRule rules[] = {
+static const ParseRule rules[] = {
   [T_LPAREN]      = {grouping, call,   PREC_CALL},
   [T_RPAREN]      = {NULL,     NULL,   PREC_NONE},
-  [T_LBRACE]      = {NULL,     NULL,   PREC_NONE}, 
+  [T_LBRACE]      = {map_literal, NULL, PREC_NONE},
   [T_RBRACE]      = {NULL,     NULL,   PREC_NONE},
-  [T_LBRACKET]    = {NULL,     NULL,   PREC_NONE}, 
+  [T_LBRACKET]    = {list_literal, NULL, PREC_NONE},
   [T_RBRACKET]    = {NULL,     NULL,   PREC_NONE},
   [T_COMMA]       = {NULL,     NULL,   PREC_NONE},
   [T_DOT]         = {NULL,     get,    PREC_CALL},
   [T_OP]          = {unary,    binary, PREC_TERM},
   [T_LOGIC_OP]    = {unary,    binary, PREC_AND},
   [T_COMP_OP]     = {NULL,     binary, PREC_EQUALITY},
-  [T_ASSIGN]      = {NULL,     NULL,   PREC_ASSIGNMENT},
+  [T_ASSIGN]      = {NULL,     NULL,   PREC_NONE},
   [T_IDENTIFIER]  = {primary,  NULL,   PREC_NONE},
   [T_NUMBER]      = {primary,  NULL,   PREC_NONE},
   [T_STRING]      = {primary,  NULL,   PREC_NONE},
@@ -118,20 +152,23 @@ ParseRule rules[] = {
   [T_EOF]         = {NULL,     NULL,   PREC_NONE},
 };
 
+static const ParseRule factor_rule = {unary, binary, PREC_FACTOR};
+static const ParseRule or_rule = {unary, binary, PREC_OR};
+
 
 static Expression* parse_precedence(Parser* p, Precedence precedence) {
     advance(p);
-    PrefixParseFn prefix_rule = get_rule(p, previous_token(p).type)->prefix;
+    PrefixParseFn prefix_rule = get_rule(previous_token(p))->prefix;
     if (prefix_rule == NULL) {
-        fprintf(stderr, "ParseError on line %d: Expected expression.\n", previous_token(p).line);
+        parser_error(p, "ParseError on line %d: Expected expression.", previous_token(p).line);
         return NULL;
     }
 
     Expression* expr = prefix_rule(p);
 
-    while (precedence <= get_rule(p, current_token(p).type)->precedence) {
+    while (!p->had_error && precedence <= get_rule(current_token(p))->precedence) {
         advance(p);
-        InfixParseFn infix_rule = get_rule(p, previous_token(p).type)->infix;
+        InfixParseFn infix_rule = get_rule(previous_token(p))->infix;
         expr = infix_rule(p, expr);
     }
 
@@ -142,26 +179,62 @@ Expression* parse_expression(Parser* p) {
     return parse_precedence(p, PREC_ASSIGNMENT);
 }
 
+static bool is_number_literal(Expression* expr) {
+    return expr != NULL && expr->type == EXPR_LITERAL && expr->as.literal.literal.type == T_NUMBER;
+}
+
+// Collapses num arithmetic on two literals into a single literal so loop
+// bodies don't redo it on every iteration. Folded literals have no lexeme.
+static Expression* fold_numeric_binary(Expression* expr) {
+    Expression* left = expr->as.binary.left;
+    Expression* right = expr->as.binary.right;
+    if (!is_number_literal(left) || !is_number_literal(right)) return expr;
+
+    double a = left->as.literal.number;
+    double b = right->as.literal.number;
+    double result;
+    const char* op = expr->as.binary.op.value;
+    if (strcmp(op, "+") == 0) result = a + b;
+    else if (strcmp(op, "-") == 0) result = a - b;
+    else if (strcmp(op, "*") == 0) result = a * b;
+    else if (strcmp(op, "/") == 0 && b != 0) result = a / b;
+    else return expr;
+
+    left->base.line = expr->base.line;
+    left->as.literal.literal.value = NULL;
+    left->as.literal.number = result;
+    free(right);
+    free(expr);
+    return left;
+}
+
 Expression* primary(Parser* p) {
     Expression* expr = malloc(sizeof(Expression));
     expr->base.node_type = NODE_TYPE_EXPRESSION;
+    expr->value_type = TYPE_UNKNOWN;
     expr->base.line = previous_token(p).line;
 
     switch(previous_token(p).type) {
-        case T_BOOL:
         case T_NUMBER:
+            expr->type = EXPR_LITERAL;
+            expr->as.literal.literal = previous_token(p);
+            parse_num(previous_token(p).value, strlen(previous_token(p).value), &expr->as.literal.number);
+            break;
+        case T_BOOL:
         case T_STRING:
             expr->type = EXPR_LITERAL;
             expr->as.literal.literal = previous_token(p);
+            expr->as.literal.number = 0;
             break;
         case T_IDENTIFIER:
             expr->type = EXPR_IDENTIFIER;
             expr->as.identifier.identifier = previous_token(p);
+            expr->as.identifier.binding = (Binding){ .depth = 0, .slot = -1 };
             break;
         default:
-            fprintf(stderr, "ParseError on line %d: Expected primary expression.\n", previous_token(p).line);
+            parser_error(p, "ParseError on line %d: Expected primary expression.", previous_token(p).line);
             free(expr);
-            exit(1);
+            return NULL;
     }
     return expr;
 }
@@ -169,10 +242,16 @@ Expression* primary(Parser* p) {
 Expression* grouping(Parser* p) {
     Expression* expr = malloc(sizeof(Expression));
     expr->base.node_type = NODE_TYPE_EXPRESSION;
+    expr->value_type = TYPE_UNKNOWN;
     expr->base.line = previous_token(p).line;
     expr->type = EXPR_GROUPING;
     expr->as.grouping.expression = parse_expression(p);
     consume(p, T_RPAREN, "Expected ')' after expression.");
+    if (is_number_literal(expr->as.grouping.expression)) {
+        Expression* inner = expr->as.grouping.expression;
+        free(expr);
+        return inner;
+    }
     return expr;
 }
 
@@ -180,8 +259,16 @@ Expression* unary(Parser* p) {
     Token operator = previous_token(p);
     Expression* right = parse_precedence(p, PREC_UNARY);
 
+    if (strcmp(operator.value, "-") == 0 && is_number_literal(right)) {
+        right->as.literal.number = -right->as.literal.number;
+        right->as.literal.literal.value = NULL;
+        right->base.line = operator.line;
+        return right;
+    }
+
     Expression* expr = malloc(sizeof(Expression));
     expr->base.node_type = NODE_TYPE_EXPRESSION;
+    expr->value_type = TYPE_UNKNOWN;
     expr->base.line = operator.line;
     expr->type = EXPR_UNARY;
     expr->as.unary.op = operator;
@@ -191,11 +278,12 @@ Expression* unary(Parser* p) {
 
 Expression* binary(Parser* p, Expression* left) {
     Token operator = previous_token(p);
-    ParseRule* rule = get_rule(p, operator.type);
+    const ParseRule* rule = get_rule(operator);
     Expression* right = parse_precedence(p, (Precedence)(rule->precedence + 1));
     
     Expression* expr = malloc(sizeof(Expression));
     expr->base.node_type = NODE_TYPE_EXPRESSION;
+    expr->value_type = TYPE_UNKNOWN;
     expr->base.line = operator.line;
 
     if (operator.type == T_KEYWORD && strcmp(operator.value, "in") == 0) {
@@ -208,6 +296,7 @@ Expression* binary(Parser* p, Expression* left) {
         expr->as.binary.left = left;
         expr->as.binary.op = operator;
         expr->as.binary.right = right;
+        return fold_numeric_binary(expr);
     }
     return expr;
 }
@@ -215,12 +304,25 @@ Expression* binary(Parser* p, Expression* left) {
 Expression* call(Parser* p, Expression* left) {
     Expression* expr = malloc(sizeof(Expression));
     expr->base.node_type = NODE_TYPE_EXPRESSION;
+    expr->value_type = TYPE_UNKNOWN;
     expr->base.line = previous_token(p).line;
     expr->type = EXPR_CALL;
     expr->as.call.callee = left;
     expr->as.call.args = NULL;
     expr->as.call.count = 0;
+    if (!check(p, T_RPAREN)) {
+        int capacity = 4;
+        expr->as.call.args = malloc(sizeof(Expression*) * capacity);
+        do {
+            if (expr->as.call.count >= capacity) {
+                capacity *= 2;
+                expr->as.call.args = realloc(expr->as.call.args, sizeof(Expression*) * capacity);
+            }
+            expr->as.call.args[expr->as.call.count++] = parse_expression(p);
+        } while (match(p, 1, T_COMMA));
+    }
     consume(p, T_RPAREN, "Expect ')' after arguments.");
+    resolve_command_call(p, expr);
     return expr;
 }
 
@@ -229,6 +331,7 @@ Expression* get(Parser* p, Expression* left) {
     
     Expression* expr = malloc(sizeof(Expression));
     expr->base.node_type = NODE_TYPE_EXPRESSION;
+    expr->value_type = TYPE_UNKNOWN;
     expr->base.line = name.line;
     expr->type = EXPR_GET;
     expr->as.get.object = left;
@@ -236,10 +339,203 @@ Expression* get(Parser* p, Expression* left) {
     return expr;
 }
 
-Statement* parse_let_statement(Parser* p) {
-    Token name = consume(p, T_IDENTIFIER, "Expect variable name.");
+// Counts the items of the literal whose opening bracket was just consumed,
+// so its element arrays can be allocated at their final size.
+static int count_literal_items(Parser* p) {
+    int depth = 0;
+    int items = 0;
+    for (int i = p->current; i < p->count; i++) {
+        switch (p->tokens[i].type) {
+            case T_LPAREN:
+            case T_LBRACKET:
+            case T_LBRACE:
+                depth++;
+                break;
+            case T_RPAREN:
+            case T_RBRACKET:
+            case T_RBRACE:
+                if (depth == 0) return i == p->current ? 0 : items + 1;
+                depth--;
+                break;
+            case T_COMMA:
+                if (depth == 0) items++;
+                break;
+            case T_NEWLINE:
+            case T_EOF:
+                return items + 1;
+            default:
+                break;
+        }
+    }
+    return items + 1;
+}
+
+static Expression* list_literal(Parser* p) {
+    Expression* expr = malloc(sizeof(Expression));
+    expr->base.node_type = NODE_TYPE_EXPRESSION;
+    expr->value_type = TYPE_UNKNOWN;
+    expr->base.line = previous_token(p).line;
+    expr->type = EXPR_LIST;
+    expr->as.list.count = 0;
+    expr->as.list.constant = NULL;
+
+    int capacity = count_literal_items(p);
+    expr->as.list.elements = capacity > 0 ? malloc(sizeof(Expression*) * capacity) : NULL;
+    if (capacity > 0) {
+        do {
+            expr->as.list.elements[expr->as.list.count++] = parse_expression(p);
+        } while (!p->had_error && expr->as.list.count < capacity && match(p, 1, T_COMMA));
+    }
+    consume(p, T_RBRACKET, "Expect ']' after list items.");
+
+    if (!p->had_error) expr->as.list.constant = constant_from_literal(expr);
+    return expr;
+}
+
+static Expression* map_literal(Parser* p) {
+    Expression* expr = malloc(sizeof(Expression));
+    expr->base.node_type = NODE_TYPE_EXPRESSION;
+    expr->value_type = TYPE_UNKNOWN;
+    expr->base.line = previous_token(p).line;
+    expr->type = EXPR_MAP;
+    expr->as.map.count = 0;
+    expr->as.map.constant = NULL;
+
+    int capacity = count_literal_items(p);
+    expr->as.map.keys = capacity > 0 ? malloc(sizeof(Expression*) * capacity) : NULL;
+    expr->as.map.values = capacity > 0 ? malloc(sizeof(Expression*) * capacity) : NULL;
+    if (capacity > 0) {
+        do {
+            int i = expr->as.map.count++;
+            expr->as.map.keys[i] = parse_expression(p);
+            expr->as.map.values[i] = NULL;
+            consume(p, T_COLON, "Expect ':' after map key.");
+            if (p->had_error) break;
+            expr->as.map.values[i] = parse_expression(p);
+        } while (!p->had_error && expr->as.map.count < capacity && match(p, 1, T_COMMA));
+    }
+    consume(p, T_RBRACE, "Expect '}' after map entries.");
+
+    if (!p->had_error) expr->as.map.constant = constant_from_literal(expr);
+    return expr;
+}
+
+static bool starts_argument(Parser* p) {
+    switch (current_token(p).type) {
+        case T_NUMBER:
+        case T_STRING:
+        case T_BOOL:
+        case T_IDENTIFIER:
+        case T_LPAREN:
+        case T_LBRACKET:
+        case T_LBRACE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Commands defined by this parse come first, then the top-level commands
+// that were visible where a lazily parsed body was defined.
+static Statement* find_command(Parser* p, const char* name) {
+    for (int i = p->command_count - 1; i >= 0; i--) {
+        if (strcmp(p->commands[i]->as.command_def.name.value, name) == 0) {
+            return p->commands[i];
+        }
+    }
+    for (int i = p->outer_count - 1; i >= 0; i--) {
+        if (strcmp(p->outer_commands[i]->as.command_def.name.value, name) == 0) {
+            return p->outer_commands[i];
+        }
+    }
+    return NULL;
+}
+
+// Commands must be defined before use, so a call can only reach a command
+// whose body is still being parsed by recursing into it.
+static void resolve_command_call(Parser* p, Expression* call_expr) {
+    Expression* callee = call_expr->as.call.callee;
+    if (callee->type != EXPR_IDENTIFIER) return;
+    Statement* command = find_command(p, callee->as.identifier.identifier.value);
+    if (command == NULL) return;
+
+    if (call_expr->as.call.count != command->as.command_def.param_count) {
+        parser_error(p, "ParseError on line %d: Command '%s' expects %d argument(s), got %d.",
+            call_expr->base.line, command->as.command_def.name.value,
+            command->as.command_def.param_count, call_expr->as.call.count);
+        return;
+    }
+    if (command->as.command_def.parsing) {
+        command->as.command_def.is_recursive = true;
+    }
+    if (p->parallel_depth > 0) {
+        command->as.command_def.called_in_parallel = true;
+    }
+}
+
+static bool is_command_name(Parser* p, const char* name) {
+    static const char* builtins[] = { "upper", "lower", "trim", "reverse" };
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        if (strcmp(builtins[i], name) == 0) return true;
+    }
+    return find_command(p, name) != NULL;
+}
+
+// Commands are called without brackets (`shout "hi"`), so a command name or
+// module member followed by more operands on the same line becomes a call.
+static Expression* parse_command_expression(Parser* p) {
+    Expression* expr = parse_expression(p);
+    if (expr == NULL) return NULL;
+    // A user command named on its own is still a call, so its arity is
+    // checked like any other.
+    bool bare_command = expr->type == EXPR_IDENTIFIER &&
+        find_command(p, expr->as.identifier.identifier.value) != NULL;
+    if (!starts_argument(p) && !bare_command) {
+        return expr;
+    }
+    if (expr->type != EXPR_GET &&
+        (expr->type != EXPR_IDENTIFIER || !is_command_name(p, expr->as.identifier.identifier.value))) {
+        return expr;
+    }
+
+    Expression* call_expr = malloc(sizeof(Expression));
+    call_expr->base.node_type = NODE_TYPE_EXPRESSION;
+    call_expr->value_type = TYPE_UNKNOWN;
+    call_expr->base.line = expr->base.line;
+    call_expr->type = EXPR_CALL;
+    call_expr->as.call.callee = expr;
+    call_expr->as.call.count = 0;
+    int capacity = 4;
+    call_expr->as.call.args = malloc(sizeof(Expression*) * capacity);
+    while (starts_argument(p)) {
+        if (call_expr->as.call.count >= capacity) {
+            capacity *= 2;
+            call_expr->as.call.args = realloc(call_expr->as.call.args, sizeof(Expression*) * capacity);
+        }
+        call_expr->as.call.args[call_expr->as.call.count++] = parse_command_expression(p);
+    }
+    resolve_command_call(p, call_expr);
+    return call_expr;
+}
+
+static ValueType parse_type_annotation(Parser* p) {
+    Token type_name = consume(p, T_KEYWORD, "Expect type name after ':'.");
+    if (strcmp(type_name.value, "num") == 0) return TYPE_NUM;
+    if (strcmp(type_name.value, "text") == 0) return TYPE_TEXT;
+    if (strcmp(type_name.value, "bool") == 0) return TYPE_BOOL;
+    if (strcmp(type_name.value, "list") == 0) return TYPE_LIST;
+    if (strcmp(type_name.value, "map") == 0) return TYPE_MAP;
+    parser_error(p, "ParseError on line %d: Unknown type '%s'.", type_name.line, type_name.value);
+    return TYPE_UNKNOWN;
+}
+
+static Statement* finish_let_statement(Parser* p, Token name) {
+    ValueType declared_type = TYPE_UNKNOWN;
+    if (match(p, 1, T_COLON)) {
+        declared_type = parse_type_annotation(p);
+    }
     consume(p, T_ASSIGN, "Expect '=' after variable name.");
-    Expression* initializer = parse_expression(p);
+    Expression* initializer = parse_command_expression(p);
     consume(p, T_NEWLINE, "Expect newline after variable declaration.");
 
     Statement* stmt = malloc(sizeof(Statement));
@@ -247,16 +543,23 @@ Statement* parse_let_statement(Parser* p) {
     stmt->base.line = name.line;
     stmt->type = STMT_LET_ASSIGN;
     stmt->as.let_assign.name = name;
+    stmt->as.let_assign.declared_type = declared_type;
     stmt->as.let_assign.initializer = initializer;
+    stmt->as.let_assign.binding = (Binding){ .depth = 0, .slot = -1 };
     return stmt;
 }
 
+Statement* parse_let_statement(Parser* p) {
+    Token name = consume(p, T_IDENTIFIER, "Expect variable name.");
+    return finish_let_statement(p, name);
+}
+
 Statement* parse_write_statement(Parser* p) {
     Statement* stmt = malloc(sizeof(Statement));
     stmt->base.node_type = NODE_TYPE_STATEMENT;
     stmt->base.line = previous_token(p).line;
     stmt->type = STMT_WRITE;
-    stmt->as.write_stmt.expression = parse_expression(p);
+    stmt->as.write_stmt.expression = parse_command_expression(p);
     consume(p, T_NEWLINE, "Expect newline after write statement.");
     return stmt;
 }
@@ -269,66 +572,408 @@ Statement* parse_ask_statement(Parser* p) {
     stmt->as.ask_stmt.prompt = parse_expression(p);
     Token as_keyword = consume(p, T_KEYWORD, "Expect 'as' after ask prompt.");
     if (strcmp(as_keyword.value, "as") != 0) {
-        fprintf(stderr, "ParseError on line %d: Expected 'as' keyword.\n", as_keyword.line);
-        exit(1);
+        parser_error(p, "ParseError on line %d: Expected 'as' keyword.", as_keyword.line);
     }
     stmt->as.ask_stmt.variable = consume(p, T_IDENTIFIER, "Expect variable name after 'as'.");
+    stmt->as.ask_stmt.binding = (Binding){ .depth = 0, .slot = -1 };
     consume(p, T_NEWLINE, "Expect newline after ask statement.");
     return stmt;
 }
 
+static Statement** parse_block(Parser* p, int* count) {
+    consume(p, T_COLON, "Expect ':' before block.");
+    consume(p, T_NEWLINE, "Expect newline after ':'.");
+    consume(p, T_INDENT, "Expect indented block.");
+
+    int capacity = 8;
+    Statement** body = malloc(sizeof(Statement*) * capacity);
+    *count = 0;
+    while (!check(p, T_DEDENT) && !is_at_end(p) && !p->had_error) {
+        if (*count >= capacity) {
+            capacity *= 2;
+            body = realloc(body, sizeof(Statement*) * capacity);
+        }
+        body[(*count)++] = parse_statement(p);
+    }
+    consume(p, T_DEDENT, "Expect dedent to close block.");
+    return body;
+}
+
+Statement* parse_while_statement(Parser* p) {
+    Statement* stmt = malloc(sizeof(Statement));
+    stmt->base.node_type = NODE_TYPE_STATEMENT;
+    stmt->base.line = previous_token(p).line;
+    stmt->type = STMT_WHILE;
+    stmt->as.while_stmt.condition = parse_expression(p);
+    stmt->as.while_stmt.body = parse_block(p, &stmt->as.while_stmt.body_count);
+    return stmt;
+}
+
+Statement* parse_loop_statement(Parser* p) {
+    Statement* stmt = malloc(sizeof(Statement));
+    stmt->base.node_type = NODE_TYPE_STATEMENT;
+    stmt->base.line = previous_token(p).line;
+    stmt->type = STMT_LOOP;
+    stmt->as.loop_stmt.parallel = false;
+    stmt->as.loop_stmt.count = parse_expression(p);
+    stmt->as.loop_stmt.body = parse_block(p, &stmt->as.loop_stmt.body_count);
+    return stmt;
+}
+
+Statement* parse_parallel_statement(Parser* p) {
+    Token keyword = consume(p, T_KEYWORD, "Expect 'loop' after 'parallel'.");
+    if (strcmp(keyword.value, "loop") != 0) {
+        parser_error(p, "ParseError on line %d: Expected 'loop' after 'parallel'.", keyword.line);
+    }
+    p->parallel_depth++;
+    Statement* stmt = parse_loop_statement(p);
+    p->parallel_depth--;
+    stmt->as.loop_stmt.parallel = true;
+    return stmt;
+}
+
+Statement* parse_jump_statement(Parser* p, StatementType type) {
+    Statement* stmt = malloc(sizeof(Statement));
+    stmt->base.node_type = NODE_TYPE_STATEMENT;
+    stmt->base.line = previous_token(p).line;
+    stmt->type = type;
+    consume(p, T_NEWLINE, "Expect newline after break/continue.");
+    return stmt;
+}
+
+// Skips an indented block by matching INDENT/DEDENT tokens, without
+// building any nodes.
+static void skip_block(Parser* p) {
+    consume(p, T_COLON, "Expect ':' before block.");
+    consume(p, T_NEWLINE, "Expect newline after ':'.");
+    consume(p, T_INDENT, "Expect indented block.");
+    int depth = 1;
+    while (depth > 0 && !is_at_end(p)) {
+        if (check(p, T_INDENT)) depth++;
+        else if (check(p, T_DEDENT)) depth--;
+        advance(p);
+    }
+    if (depth > 0) {
+        parser_error(p, "ParseError on line %d: Expect dedent to close block.", current_token(p).line);
+    }
+}
+
+// The checker can't see into a skipped body, so it widens every name the
+// body may assign: identifiers before `=`, `+=`, `++` or `:` and after `let`
+// or `as`. Extra names only cost the checker a proof.
+static void collect_skipped_writes(Parser* p, Statement* stmt) {
+    int capacity = 0;
+    for (int i = stmt->as.command_def.body_start + 1; i < stmt->as.command_def.body_end; i++) {
+        if (p->tokens[i].type != T_IDENTIFIER) continue;
+        TokenType next = p->tokens[i + 1].type;
+        Token before = p->tokens[i - 1];
+        bool written = next == T_ASSIGN || next == T_COMP_ASSIGN || next == T_INC_DEC || next == T_COLON ||
+            (before.type == T_KEYWORD && (strcmp(before.value, "let") == 0 || strcmp(before.value, "as") == 0));
+        if (!written) continue;
+        if (stmt->as.command_def.skipped_write_count >= capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            stmt->as.command_def.skipped_writes = realloc(stmt->as.command_def.skipped_writes, sizeof(char*) * capacity);
+        }
+        stmt->as.command_def.skipped_writes[stmt->as.command_def.skipped_write_count++] = p->tokens[i].value;
+    }
+}
+
+// Counts nested statements too, so a loop full of work isn't taken for a
+// small command.
+static int body_size(Statement** body, int count) {
+    int size = 0;
+    for (int i = 0; i < count; i++) {
+        Statement* stmt = body[i];
+        if (stmt == NULL) continue;
+        size++;
+        switch (stmt->type) {
+            case STMT_IF:
+                size += body_size(stmt->as.if_stmt.body, stmt->as.if_stmt.body_count);
+                size += body_size(&stmt->as.if_stmt.else_branch, 1);
+                break;
+            case STMT_WHILE:
+                size += body_size(stmt->as.while_stmt.body, stmt->as.while_stmt.body_count);
+                break;
+            case STMT_LOOP:
+                size += body_size(stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count);
+                break;
+            case STMT_CHECK:
+                for (int j = 0; j < stmt->as.check_stmt.case_count; j++) {
+                    size += body_size(stmt->as.check_stmt.cases[j].body, stmt->as.check_stmt.cases[j].body_count);
+                }
+                break;
+            case STMT_COMMAND_DEF:
+                size += body_size(stmt->as.command_def.body, stmt->as.command_def.body_count);
+                break;
+            default:
+                break;
+        }
+    }
+    return size;
+}
+
+static void finish_command_body(Parser* p, Statement* stmt) {
+    stmt->as.command_def.parsing = true;
+    int body_count = 0;
+    Statement** body = parse_block(p, &body_count);
+    stmt->as.command_def.parsing = false;
+    stmt->as.command_def.parsed = true;
+    stmt->as.command_def.body = body;
+    stmt->as.command_def.body_count = body_count;
+    stmt->as.command_def.inlinable = !stmt->as.command_def.is_recursive &&
+        body_size(body, body_count) <= INLINE_MAX_STATEMENTS;
+}
+
+Statement* parse_command_statement(Parser* p) {
+    Statement* stmt = malloc(sizeof(Statement));
+    stmt->base.node_type = NODE_TYPE_STATEMENT;
+    stmt->base.line = previous_token(p).line;
+    stmt->type = STMT_COMMAND_DEF;
+    stmt->as.command_def.name = consume(p, T_IDENTIFIER, "Expect command name.");
+    stmt->as.command_def.body = NULL;
+    stmt->as.command_def.body_count = 0;
+    stmt->as.command_def.is_recursive = false;
+    stmt->as.command_def.inlinable = false;
+    stmt->as.command_def.parsed = false;
+    stmt->as.command_def.parsing = false;
+    stmt->as.command_def.frame_size = 0;
+    stmt->as.command_def.called_in_parallel = false;
+    stmt->as.command_def.prepared = false;
+    stmt->as.command_def.prepare_result = 0;
+    stmt->as.command_def.seen_before = 0;
+    stmt->as.command_def.skipped_writes = NULL;
+    stmt->as.command_def.skipped_write_count = 0;
+
+    int capacity = 4;
+    stmt->as.command_def.params = malloc(sizeof(Token) * capacity);
+    stmt->as.command_def.param_count = 0;
+    while (check(p, T_IDENTIFIER)) {
+        if (stmt->as.command_def.param_count >= capacity) {
+            capacity *= 2;
+            stmt->as.command_def.params = realloc(stmt->as.command_def.params, sizeof(Token) * capacity);
+        }
+        stmt->as.command_def.params[stmt->as.command_def.param_count++] = current_token(p);
+        advance(p);
+    }
+
+    if (p->command_count >= p->command_capacity) {
+        p->command_capacity = p->command_capacity ? p->command_capacity * 2 : 8;
+        p->commands = realloc(p->commands, sizeof(Statement*) * p->command_capacity);
+    }
+    p->commands[p->command_count++] = stmt;
+    stmt->as.command_def.visible_commands = p->command_count;
+    stmt->as.command_def.body_start = p->current;
+
+    if (p->lazy_commands && p->command_depth == 0) {
+        skip_block(p);
+        stmt->as.command_def.body_end = p->current - 1;
+        collect_skipped_writes(p, stmt);
+        return stmt;
+    }
+
+    // Commands defined inside this body are only visible inside it.
+    int visible_commands = p->command_count;
+    p->command_depth++;
+    finish_command_body(p, stmt);
+    p->command_depth--;
+    p->command_count = visible_commands;
+    stmt->as.command_def.body_end = p->current - 1;
+    return stmt;
+}
+
+Statement* parse_return_statement(Parser* p) {
+    Statement* stmt = malloc(sizeof(Statement));
+    stmt->base.node_type = NODE_TYPE_STATEMENT;
+    stmt->base.line = previous_token(p).line;
+    stmt->type = STMT_RETURN;
+    if (p->command_depth == 0) {
+        parser_error(p, "ParseError on line %d: 'return' outside of a command.", stmt->base.line);
+    }
+    stmt->as.return_stmt.value = check(p, T_NEWLINE) ? NULL : parse_command_expression(p);
+    stmt->as.return_stmt.is_tail_call = false;
+    Expression* value = stmt->as.return_stmt.value;
+    if (value != NULL && value->type == EXPR_CALL && value->as.call.callee->type == EXPR_IDENTIFIER) {
+        stmt->as.return_stmt.is_tail_call = find_command(p, value->as.call.callee->as.identifier.identifier.value) != NULL;
+    }
+    consume(p, T_NEWLINE, "Expect newline after return statement.");
+    return stmt;
+}
+
+Statement* parse_check_statement(Parser* p) {
+    Statement* stmt = malloc(sizeof(Statement));
+    stmt->base.node_type = NODE_TYPE_STATEMENT;
+    stmt->base.line = previous_token(p).line;
+    stmt->type = STMT_CHECK;
+    stmt->as.check_stmt.subject = parse_expression(p);
+    consume(p, T_COLON, "Expect ':' after check expression.");
+    consume(p, T_NEWLINE, "Expect newline after 'check ...:'.");
+    consume(p, T_INDENT, "Expect indented 'equals' cases.");
+
+    int capacity = 4;
+    stmt->as.check_stmt.cases = malloc(sizeof(CheckCase) * capacity);
+    stmt->as.check_stmt.case_count = 0;
+    while (!check(p, T_DEDENT) && !is_at_end(p) && !p->had_error) {
+        Token keyword = consume(p, T_KEYWORD, "Expect 'equals' case in check block.");
+        if (strcmp(keyword.value, "equals") != 0) {
+            parser_error(p, "ParseError on line %d: Expected 'equals' keyword.", keyword.line);
+            break;
+        }
+        if (stmt->as.check_stmt.case_count >= capacity) {
+            capacity *= 2;
+            stmt->as.check_stmt.cases = realloc(stmt->as.check_stmt.cases, sizeof(CheckCase) * capacity);
+        }
+        CheckCase* check_case = &stmt->as.check_stmt.cases[stmt->as.check_stmt.case_count++];
+        check_case->value = parse_expression(p);
+        check_case->body = parse_block(p, &check_case->body_count);
+    }
+    consume(p, T_DEDENT, "Expect dedent to close check block.");
+
+    plan_check_dispatch(stmt);
+    return stmt;
+}
+
+// Targets are a variable or a chain of fields on one, so copy_target only
+// has identifiers and gets to copy.
+static bool is_assignment_target(Expression* target) {
+    while (target != NULL && target->type == EXPR_GET) target = target->as.get.object;
+    return target != NULL && target->type == EXPR_IDENTIFIER;
+}
+
+static Expression* copy_target(Expression* target) {
+    Expression* copy = malloc(sizeof(Expression));
+    *copy = *target;
+    if (target->type == EXPR_GET) {
+        copy->as.get.object = copy_target(target->as.get.object);
+    }
+    return copy;
+}
+
+// `x += e` and `x++` are sugar for `x = x + e` and `x = x + 1`. The
+// statement keeps `is_update`, so the checker can mark proven text and list
+// `+=` to append to the target in place rather than rebuild it.
+static Expression* desugar_update(Parser* p, Expression* target, Token op) {
+    static const char* const operators[] = { "+", "-", "*", "/", "%" };
+    Expression* right;
+    if (op.type == T_INC_DEC) {
+        right = malloc(sizeof(Expression));
+        right->base.node_type = NODE_TYPE_EXPRESSION;
+        right->value_type = TYPE_UNKNOWN;
+        right->base.line = op.line;
+        right->type = EXPR_LITERAL;
+        right->as.literal.literal = (Token){ .type = T_NUMBER, .value = NULL, .line = op.line };
+        right->as.literal.number = 1;
+    } else {
+        right = parse_command_expression(p);
+    }
+
+    Token binary_op = { .type = T_OP, .value = NULL, .line = op.line };
+    for (size_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++) {
+        if (op.value[0] == operators[i][0]) binary_op.value = (char*)operators[i];
+    }
+
+    Expression* expr = malloc(sizeof(Expression));
+    expr->base.node_type = NODE_TYPE_EXPRESSION;
+    expr->value_type = TYPE_UNKNOWN;
+    expr->base.line = op.line;
+    expr->type = EXPR_BINARY;
+    expr->as.binary.left = copy_target(target);
+    expr->as.binary.op = binary_op;
+    expr->as.binary.right = right;
+    return expr;
+}
+
 Statement* parse_statement(Parser* p) {
     if (match(p, 1, T_KEYWORD)) {
         Token keyword = previous_token(p);
         if (strcmp(keyword.value, "let") == 0) return parse_let_statement(p);
         if (strcmp(keyword.value, "write") == 0) return parse_write_statement(p);
         if (strcmp(keyword.value, "ask") == 0) return parse_ask_statement(p);
+        if (strcmp(keyword.value, "while") == 0) return parse_while_statement(p);
+        if (strcmp(keyword.value, "loop") == 0) return parse_loop_statement(p);
+        if (strcmp(keyword.value, "parallel") == 0) return parse_parallel_statement(p);
+        if (strcmp(keyword.value, "break") == 0) return parse_jump_statement(p, STMT_BREAK);
+        if (strcmp(keyword.value, "continue") == 0) return parse_jump_statement(p, STMT_CONTINUE);
+        if (strcmp(keyword.value, "command") == 0) return parse_command_statement(p);
+        if (strcmp(keyword.value, "return") == 0) return parse_return_statement(p);
+        if (strcmp(keyword.value, "check") == 0) return parse_check_statement(p);
     }
 
-    Expression* expr = parse_expression(p);
+    if (check(p, T_IDENTIFIER) && p->tokens[p->current + 1].type == T_COLON) {
+        advance(p);
+        return finish_let_statement(p, previous_token(p));
+    }
+
+    Expression* expr = parse_command_expression(p);
 
-    if (match(p, 1, T_ASSIGN)) {
-        if (expr->type != EXPR_IDENTIFIER && expr->type != EXPR_GET) {
-            fprintf(stderr, "ParseError on line %d: Invalid assignment target.\n", previous_token(p).line);
-            exit(1);
+    if (match(p, 3, T_ASSIGN, T_COMP_ASSIGN, T_INC_DEC)) {
+        Token op = previous_token(p);
+        if (!is_assignment_target(expr)) {
+            parser_error(p, "ParseError on line %d: Invalid assignment target.", op.line);
+            free_expression(expr);
+            return NULL;
         }
         Statement* stmt = malloc(sizeof(Statement));
         stmt->base.node_type = NODE_TYPE_STATEMENT;
+        stmt->base.line = op.line;
         stmt->type = STMT_REASSIGN;
         stmt->as.reassign.target = expr;
-        stmt->as.reassign.value = parse_expression(p);
+        stmt->as.reassign.value = op.type == T_ASSIGN ? parse_command_expression(p) : desugar_update(p, expr, op);
+        stmt->as.reassign.is_update = op.type != T_ASSIGN;
+        stmt->as.reassign.appends = false;
         consume(p, T_NEWLINE, "Expect newline after assignment.");
         return stmt;
     }
 
     Statement* stmt = malloc(sizeof(Statement));
     stmt->base.node_type = NODE_TYPE_STATEMENT;
+    stmt->base.line = expr != NULL ? expr->base.line : current_token(p).line;
     stmt->type = STMT_EXPR;
     stmt->as.expr_stmt.expression = expr;
     consume(p, T_NEWLINE, "Expect newline after expression.");
     return stmt;
 }
 
-ProgramNode* parse(Token* tokens, int token_count) {
-    Parser parser = { .tokens = tokens, .count = token_count, .current = 0 };
+// The checker follows calls made from parallel loops into the called
+// bodies, so lazily parsed commands called there can't wait for first use.
+static bool parse_parallel_callees(ProgramNode* program, Token* tokens, const ErrorReporter* reporter) {
+    for (int i = 0; i < program->command_count; i++) {
+        Statement* command = program->commands[i];
+        if (command->as.command_def.called_in_parallel && !command->as.command_def.parsed &&
+            !parse_command_body(program, tokens, command, reporter)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// With lazy_commands, bodies of commands defined outside other commands are
+// only skipped over; parse_command_body builds them on first use.
+ProgramNode* parse(Token* tokens, int token_count, bool lazy_commands, const ErrorReporter* reporter) {
+    Parser parser = { .tokens = tokens, .count = token_count, .current = 0,
+        .lazy_commands = lazy_commands, .reporter = reporter };
 
     ProgramNode* program = malloc(sizeof(ProgramNode));
     program->base.node_type = NODE_TYPE_PROGRAM;
     program->base.line = 0;
     program->statements = malloc(sizeof(Statement*) * 32);
     program->count = 0;
+    program->commands = NULL;
+    program->command_count = 0;
+    program->globals = NULL;
+    program->global_count = 0;
+    program->checked_globals = NULL;
+    program->checked_global_count = 0;
     int capacity = 32;
 
     Token start_keyword = consume(&parser, T_KEYWORD, "Program must start with 'start' keyword.");
     if (strcmp(start_keyword.value, "start") != 0) {
-        fprintf(stderr, "ParseError: Program must start with 'start' keyword, got '%s'.\n", start_keyword.value);
-        exit(1);
+        parser_error(&parser, "ParseError: Program must start with 'start' keyword, got '%s'.", start_keyword.value);
     }
     consume(&parser, T_COLON, "Expect ':' after 'start' keyword.");
     consume(&parser, T_NEWLINE, "Expect newline after 'start:'.");
     consume(&parser, T_INDENT, "Expect indented block after 'start:'.");
 
-    while (!check(&parser, T_DEDENT) && !is_at_end(&parser)) {
+    while (!check(&parser, T_DEDENT) && !is_at_end(&parser) && !parser.had_error) {
         if (program->count >= capacity) {
             capacity *= 2;
             program->statements = realloc(program->statements, sizeof(Statement*) * capacity);
@@ -337,10 +982,43 @@ ProgramNode* parse(Token* tokens, int token_count) {
     }
 
     consume(&parser, T_DEDENT, "Expect dedent to close 'start' block.");
+    program->commands = parser.commands;
+    program->command_count = parser.command_count;
 
+    if (parser.had_error) {
+        free_ast((AstNode*)program);
+        return NULL;
+    }
+    if (lazy_commands && !parse_parallel_callees(program, tokens, reporter)) {
+        free_ast((AstNode*)program);
+        return NULL;
+    }
     return program;
 }
 
+// Builds the body of a command that parse() skipped. `tokens` must be the
+// array the program was parsed from.
+bool parse_command_body(ProgramNode* program, Token* tokens, Statement* command, const ErrorReporter* reporter) {
+    if (command->as.command_def.parsed) return true;
+
+    Parser parser = { .tokens = tokens, .count = command->as.command_def.body_end + 1,
+        .current = command->as.command_def.body_start,
+        .outer_commands = program->commands, .outer_count = command->as.command_def.visible_commands,
+        .command_depth = 1, .parallel_depth = command->as.command_def.called_in_parallel ? 1 : 0,
+        .reporter = reporter };
+    finish_command_body(&parser, command);
+    free(parser.commands);
+
+    if (parser.had_error) {
+        free_body(command->as.command_def.body, command->as.command_def.body_count);
+        command->as.command_def.body = NULL;
+        command->as.command_def.body_count = 0;
+        command->as.command_def.parsed = false;
+        return false;
+    }
+    return parse_parallel_callees(program, tokens, reporter);
+}
+
 void free_expression(Expression* expr) {
     if (expr == NULL) return;
     switch (expr->type) {
@@ -359,6 +1037,26 @@ void free_expression(Expression* expr) {
             break;
         case EXPR_CALL:
             free_expression(expr->as.call.callee);
+            for (int i = 0; i < expr->as.call.count; i++) {
+                free_expression(expr->as.call.args[i]);
+            }
+            free(expr->as.call.args);
+            break;
+        case EXPR_LIST:
+            for (int i = 0; i < expr->as.list.count; i++) {
+                free_expression(expr->as.list.elements[i]);
+            }
+            free(expr->as.list.elements);
+            constant_release(expr->as.list.constant);
+            break;
+        case EXPR_MAP:
+            for (int i = 0; i < expr->as.map.count; i++) {
+                free_expression(expr->as.map.keys[i]);
+                free_expression(expr->as.map.values[i]);
+            }
+            free(expr->as.map.keys);
+            free(expr->as.map.values);
+            constant_release(expr->as.map.constant);
             break;
         case EXPR_LITERAL:
         case EXPR_IDENTIFIER:
@@ -368,9 +1066,43 @@ void free_expression(Expression* expr) {
     free(expr);
 }
 
+void free_statement(Statement* stmt);
+
+static void free_body(Statement** body, int count) {
+    for (int i = 0; i < count; i++) {
+        free_statement(body[i]);
+    }
+    free(body);
+}
+
 void free_statement(Statement* stmt) {
     if (stmt == NULL) return;
     switch(stmt->type) {
+        case STMT_WHILE:
+            free_expression(stmt->as.while_stmt.condition);
+            free_body(stmt->as.while_stmt.body, stmt->as.while_stmt.body_count);
+            break;
+        case STMT_LOOP:
+            free_expression(stmt->as.loop_stmt.count);
+            free_body(stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count);
+            break;
+        case STMT_COMMAND_DEF:
+            free(stmt->as.command_def.params);
+            free(stmt->as.command_def.skipped_writes);
+            free_body(stmt->as.command_def.body, stmt->as.command_def.body_count);
+            break;
+        case STMT_RETURN:
+            free_expression(stmt->as.return_stmt.value);
+            break;
+        case STMT_CHECK:
+            free_expression(stmt->as.check_stmt.subject);
+            for (int i = 0; i < stmt->as.check_stmt.case_count; i++) {
+                free_expression(stmt->as.check_stmt.cases[i].value);
+                free_body(stmt->as.check_stmt.cases[i].body, stmt->as.check_stmt.cases[i].body_count);
+            }
+            free(stmt->as.check_stmt.cases);
+            free_check_dispatch(stmt);
+            break;
         case STMT_LET_ASSIGN:
             free_expression(stmt->as.let_assign.initializer);
             break;
@@ -399,13 +1131,37 @@ void free_ast(AstNode* node) {
         free_statement(prog->statements[i]);
     }
     free(prog->statements);
+    free(prog->commands);
+    free(prog->globals);
+    free(prog->checked_globals);
     free(prog);
 }
 
+const char* value_type_to_string(ValueType type) {
+    switch (type) {
+        case TYPE_NUM: return "num";
+        case TYPE_TEXT: return "text";
+        case TYPE_BOOL: return "bool";
+        case TYPE_LIST: return "list";
+        case TYPE_MAP: return "map";
+        case TYPE_NULL: return "null";
+        default: return "unknown";
+    }
+}
+
 static void print_indent(int indent) {
     for (int i = 0; i < indent; i++) printf("  ");
 }
 
+static void print_binding(Binding binding) {
+    if (binding.slot < 0) return;
+    if (binding.depth > 0) {
+        printf(" [slot %d, depth %d]", binding.slot, binding.depth);
+    } else {
+        printf(" [slot %d]", binding.slot);
+    }
+}
+
 static void print_expression(Expression* expr, int indent) {
     print_indent(indent);
     if (expr == NULL) {
@@ -414,26 +1170,66 @@ static void print_expression(Expression* expr, int indent) {
     }
     switch(expr->type) {
         case EXPR_BINARY:
-            printf("BinaryOp(%s):\n", expr->as.binary.op.value);
+            if (expr->value_type != TYPE_UNKNOWN) {
+                printf("BinaryOp(%s) [%s]:\n", expr->as.binary.op.value, value_type_to_string(expr->value_type));
+            } else {
+                printf("BinaryOp(%s):\n", expr->as.binary.op.value);
+            }
             print_expression(expr->as.binary.left, indent + 1);
             print_expression(expr->as.binary.right, indent + 1);
             break;
         case EXPR_LITERAL:
-            printf("Literal(%s)\n", expr->as.literal.literal.value);
+            if (expr->as.literal.literal.type == T_NUMBER) {
+                char number[NUM_BUFFER_SIZE];
+                format_num(expr->as.literal.number, number);
+                printf("Literal(%s)\n", number);
+            } else {
+                printf("Literal(%s)\n", expr->as.literal.literal.value);
+            }
             break;
         case EXPR_IDENTIFIER:
-            printf("Identifier(%s)\n", expr->as.identifier.identifier.value);
+            printf("Identifier(%s)", expr->as.identifier.identifier.value);
+            print_binding(expr->as.identifier.binding);
+            printf("\n");
             break;
         case EXPR_GET:
             printf("Get(%s):\n", expr->as.get.name.value);
             print_expression(expr->as.get.object, indent + 1);
             break;
+        case EXPR_CALL:
+            printf("Call(%d args):\n", expr->as.call.count);
+            print_expression(expr->as.call.callee, indent + 1);
+            for (int i = 0; i < expr->as.call.count; i++) {
+                print_expression(expr->as.call.args[i], indent + 1);
+            }
+            break;
+        case EXPR_LIST:
+            printf("List(%d items)%s:\n", expr->as.list.count, expr->as.list.constant ? " [constant]" : "");
+            for (int i = 0; i < expr->as.list.count; i++) {
+                print_expression(expr->as.list.elements[i], indent + 1);
+            }
+            break;
+        case EXPR_MAP:
+            printf("Map(%d entries)%s:\n", expr->as.map.count, expr->as.map.constant ? " [constant]" : "");
+            for (int i = 0; i < expr->as.map.count; i++) {
+                print_indent(indent + 1);
+                printf("Entry:\n");
+                print_expression(expr->as.map.keys[i], indent + 2);
+                print_expression(expr->as.map.values[i], indent + 2);
+            }
+            break;
         default:
             printf("UnknownExpr\n");
             break;
     }
 }
 
+static void print_body(Statement** body, int count, int indent) {
+    for (int i = 0; i < count; i++) {
+        print_statement(body[i], indent);
+    }
+}
+
 static void print_statement(Statement* stmt, int indent) {
     print_indent(indent);
      if (stmt == NULL) {
@@ -442,11 +1238,21 @@ static void print_statement(Statement* stmt, int indent) {
     }
     switch(stmt->type) {
         case STMT_LET_ASSIGN:
-            printf("LetAssign(%s):\n", stmt->as.let_assign.name.value);
+            if (stmt->as.let_assign.declared_type != TYPE_UNKNOWN) {
+                printf("LetAssign(%s: %s)", stmt->as.let_assign.name.value,
+                    value_type_to_string(stmt->as.let_assign.declared_type));
+                print_binding(stmt->as.let_assign.binding);
+                printf(":\n");
+                print_expression(stmt->as.let_assign.initializer, indent + 1);
+                break;
+            }
+            printf("LetAssign(%s)", stmt->as.let_assign.name.value);
+            print_binding(stmt->as.let_assign.binding);
+            printf(":\n");
             print_expression(stmt->as.let_assign.initializer, indent + 1);
             break;
         case STMT_REASSIGN:
-            printf("Reassign:\n");
+            printf("Reassign%s:\n", stmt->as.reassign.appends ? " [append]" : "");
             print_expression(stmt->as.reassign.target, indent + 1);
             print_expression(stmt->as.reassign.value, indent + 1);
             break;
@@ -455,13 +1261,57 @@ static void print_statement(Statement* stmt, int indent) {
             print_expression(stmt->as.write_stmt.expression, indent + 1);
             break;
         case STMT_ASK:
-            printf("Ask (as %s):\n", stmt->as.ask_stmt.variable.value);
+            printf("Ask (as %s)", stmt->as.ask_stmt.variable.value);
+            print_binding(stmt->as.ask_stmt.binding);
+            printf(":\n");
             print_expression(stmt->as.ask_stmt.prompt, indent + 1);
             break;
         case STMT_EXPR:
             printf("ExprStmt:\n");
             print_expression(stmt->as.expr_stmt.expression, indent + 1);
             break;
+        case STMT_WHILE:
+            printf("While:\n");
+            print_expression(stmt->as.while_stmt.condition, indent + 1);
+            print_body(stmt->as.while_stmt.body, stmt->as.while_stmt.body_count, indent + 1);
+            break;
+        case STMT_LOOP:
+            printf(stmt->as.loop_stmt.parallel ? "ParallelLoop:\n" : "Loop:\n");
+            print_expression(stmt->as.loop_stmt.count, indent + 1);
+            print_body(stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count, indent + 1);
+            break;
+        case STMT_COMMAND_DEF:
+            printf("CommandDef(%s", stmt->as.command_def.name.value);
+            for (int i = 0; i < stmt->as.command_def.param_count; i++) {
+                printf(" %s", stmt->as.command_def.params[i].value);
+            }
+            printf(")%s%s%s", stmt->as.command_def.is_recursive ? " [recursive]" : "",
+                stmt->as.command_def.inlinable ? " [inline]" : "",
+                stmt->as.command_def.parsed ? "" : " [not parsed]");
+            if (stmt->as.command_def.parsed) printf(" [%d slots]", stmt->as.command_def.frame_size);
+            printf(":\n");
+            print_body(stmt->as.command_def.body, stmt->as.command_def.body_count, indent + 1);
+            break;
+        case STMT_RETURN:
+            printf("Return%s:\n", stmt->as.return_stmt.is_tail_call ? " [tail call]" : "");
+            print_expression(stmt->as.return_stmt.value, indent + 1);
+            break;
+        case STMT_CHECK:
+            printf("Check [%s]:\n", check_dispatch_to_string(stmt->as.check_stmt.dispatch));
+            print_expression(stmt->as.check_stmt.subject, indent + 1);
+            for (int i = 0; i < stmt->as.check_stmt.case_count; i++) {
+                print_indent(indent + 1);
+                printf("Equals:\n");
+                print_expression(stmt->as.check_stmt.cases[i].value, indent + 2);
+                print_body(stmt->as.check_stmt.cases[i].body, stmt->as.check_stmt.cases[i].body_count, indent + 2);
+            }
+            break;
+        case STMT_BREAK:
+            printf("Break\n");
+            break;
+        case STMT_CONTINUE:
+            printf("Continue\n");
+            break;
         default:
             printf("UnknownStmt\n");
             break;
@@ -472,33 +1322,26 @@ void print_ast(AstNode* node) {
     if (node == NULL) return;
     ProgramNode* prog = (ProgramNode*)node;
     printf("--- Abstract Syntax Tree ---\n");
-    printf("Program:\n");
+    printf("Program [%d slots]:\n", prog->global_count);
     for (int i = 0; i < prog->count; i++) {
         print_statement(prog->statements[i], 1);
     }
     printf("--------------------------\n");
 }
 
-static ParseRule* get_rule(Parser* p, TokenType type) {
-    if (type == T_KEYWORD) {
-        if (strcmp(current_token(p).value, "in") == 0) {
+static const ParseRule* get_rule(Token token) {
+    if (token.type == T_KEYWORD) {
+        if (strcmp(token.value, "in") == 0) {
             return &rules[T_KEYWORD];
         }
         return &rules[T_EOF];
     }
 
-    if (type == T_OP) {
-        if (strcmp(current_token(p).value, "*") == 0 || strcmp(current_token(p).value, "/") == 0) {
-            rules[T_OP].precedence = PREC_FACTOR;
-        } else {
-            rules[T_OP].precedence = PREC_TERM;
-        }
-    } else if (type == T_LOGIC_OP) {
-        if (strcmp(current_token(p).value, "or") == 0) {
-            rules[T_LOGIC_OP].precedence = PREC_OR;
-        } else {
-            rules[T_LOGIC_OP].precedence = PREC_AND;
-        }
+    if (token.type == T_OP && (strcmp(token.value, "*") == 0 || strcmp(token.value, "/") == 0 || strcmp(token.value, "%") == 0)) {
+        return &factor_rule;
+    }
+    if (token.type == T_LOGIC_OP && strcmp(token.value, "or") == 0) {
+        return &or_rule;
     }
-    return &rules[type];
+    return &rules[token.type];
 }
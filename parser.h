@@ -41,6 +41,16 @@ typedef enum {
     EXPR_IN,
 } ExpressionType;
 
+typedef enum {
+    TYPE_UNKNOWN,
+    TYPE_NUM,
+    TYPE_TEXT,
+    TYPE_BOOL,
+    TYPE_LIST,
+    TYPE_MAP,
+    TYPE_NULL
+} ValueType;
+
 typedef struct AstNode {
     AstNodeType node_type;
     int line;
@@ -48,23 +58,48 @@ typedef struct AstNode {
 
 struct Statement;
 struct Expression;
+struct FlintConstant;
+
+// Where a variable lives once resolved: `slot` indexes the frame `depth`
+// command frames out from the current one (0 is the current frame). A slot
+// of -1 means the name is not a variable (a command, builtin or module).
+typedef struct {
+    int depth;
+    int slot;
+} Binding;
+
+// A top-level variable as the type checker left it, kept for command bodies
+// checked later. `seen_at` orders first assignments (-1 if never assigned).
+typedef struct {
+    const char* name;
+    ValueType type;
+    bool annotated;
+    int seen_at;
+} CheckedGlobal;
 
 typedef struct {
     AstNode base;
     struct Statement** statements;
     int count;
+    struct Statement** commands;
+    int command_count;
+    const char** globals;
+    int global_count;
+    CheckedGlobal* checked_globals;
+    int checked_global_count;
 } ProgramNode;
 
 typedef struct Expression {
     AstNode base;
     ExpressionType type;
+    ValueType value_type;
     union {
         struct { struct Expression* left; Token op; struct Expression* right; } binary;
         struct { Token op; struct Expression* right; } unary;
-        struct { Token literal; } literal;
-        struct { Token identifier; } identifier;
-        struct { struct Expression** elements; int count; } list;
-        struct { struct Expression** keys; struct Expression** values; int count; } map;
+        struct { Token literal; double number; } literal;
+        struct { Token identifier; Binding binding; } identifier;
+        struct { struct Expression** elements; int count; struct FlintConstant* constant; } list;
+        struct { struct Expression** keys; struct Expression** values; int count; struct FlintConstant* constant; } map;
         struct { struct Expression* callee; struct Expression** args; int count; } call;
         struct { struct Expression* object; Token name; } get;
         struct { struct Expression* expression; } grouping;
@@ -72,27 +107,48 @@ typedef struct Expression {
     } as;
 } Expression;
 
+typedef enum {
+    DISPATCH_CHAIN,
+    DISPATCH_JUMP_TABLE,
+    DISPATCH_HASH_TABLE
+} CheckDispatch;
+
+typedef struct {
+    Expression* value;
+    struct Statement** body;
+    int body_count;
+} CheckCase;
+
 typedef struct Statement {
     AstNode base;
     StatementType type;
     union {
-        struct { Token name; Expression* initializer; } let_assign;
-        struct { Expression* target; Expression* value; } reassign;
+        struct { Token name; ValueType declared_type; Expression* initializer; Binding binding; } let_assign;
+        struct { Expression* target; Expression* value; bool is_update; bool appends; } reassign;
         struct { Expression* condition; struct Statement** body; int body_count; struct Statement* else_branch; } if_stmt;
         struct { Expression* condition; struct Statement** body; int body_count; } while_stmt;
-        struct { Expression* count; struct Statement** body; int body_count; } loop_stmt;
-        struct { Token name; Token* params; int param_count; struct Statement** body; int body_count; } command_def;
+        struct { Expression* count; struct Statement** body; int body_count; bool parallel; } loop_stmt;
+        struct {
+            Token name; Token* params; int param_count; struct Statement** body; int body_count;
+            bool is_recursive; bool inlinable;
+            bool parsed; bool parsing; int body_start; int body_end; int visible_commands;
+            int frame_size; bool called_in_parallel; bool prepared; int prepare_result; int seen_before;
+            const char** skipped_writes; int skipped_write_count;
+        } command_def;
+        struct { Expression* subject; CheckCase* cases; int case_count; CheckDispatch dispatch; int* table; int table_size; long table_base; } check_stmt;
         struct { Expression* expression; } write_stmt;
-        struct { Expression* prompt; Token variable; } ask_stmt;
+        struct { Expression* prompt; Token variable; Binding binding; } ask_stmt;
         struct { Expression* seconds; } wait_stmt;
-        struct { Expression* value; } return_stmt;
+        struct { Expression* value; bool is_tail_call; } return_stmt;
         struct { Expression* expression; } expr_stmt;
     } as;
 } Statement;
 
 
-ProgramNode* parse(Token* tokens, int token_count);
+ProgramNode* parse(Token* tokens, int token_count, bool lazy_commands, const ErrorReporter* reporter);
+bool parse_command_body(ProgramNode* program, Token* tokens, struct Statement* command, const ErrorReporter* reporter);
 void free_ast(AstNode* node);
 void print_ast(AstNode* node);
+const char* value_type_to_string(ValueType type);
 
 #endif
@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "resolver.h"
+
+// One frame per command call plus one for the top level. Variables get the
+// next free slot the first time they're assigned; blocks don't open frames.
+typedef struct Frame {
+    const char** names;
+    int count;
+    int capacity;
+    Statement** commands;
+    int command_count;
+    int command_capacity;
+    struct Frame* enclosing;
+} Frame;
+
+typedef struct {
+    const char* name;
+    int line;
+} Undefined;
+
+typedef struct {
+    Frame* frame;
+    int error_count;
+    Undefined* reported;
+    int reported_count;
+    int reported_capacity;
+    const ErrorReporter* reporter;
+} Resolver;
+
+static const char* const builtin_names[] = { "upper", "lower", "trim", "reverse", "random" };
+
+static void resolve_expression(Resolver* r, Expression* expr);
+static void resolve_body(Resolver* r, Statement** body, int count);
+
+// `x.y++` is desugared to `x.y = x.y + 1`, so one name written once can be
+// read more than once; each undefined name is reported once per line.
+static void undefined_error(Resolver* r, int line, const char* name) {
+    for (int i = 0; i < r->reported_count; i++) {
+        if (r->reported[i].line == line && strcmp(r->reported[i].name, name) == 0) return;
+    }
+    if (r->reported_count >= r->reported_capacity) {
+        r->reported_capacity = r->reported_capacity ? r->reported_capacity * 2 : 8;
+        r->reported = realloc(r->reported, sizeof(Undefined) * r->reported_capacity);
+    }
+    r->reported[r->reported_count++] = (Undefined){ .name = name, .line = line };
+    report_error(r->reporter, "NameError on line %d: Undefined variable '%s'.", line, name);
+    r->error_count++;
+}
+
+static bool lookup(Frame* frame, const char* name, Binding* binding) {
+    for (int depth = 0; frame != NULL; frame = frame->enclosing, depth++) {
+        for (int i = 0; i < frame->count; i++) {
+            if (strcmp(frame->names[i], name) == 0) {
+                binding->depth = depth;
+                binding->slot = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static bool is_command_name(Frame* frame, const char* name) {
+    for (size_t i = 0; i < sizeof(builtin_names) / sizeof(builtin_names[0]); i++) {
+        if (strcmp(builtin_names[i], name) == 0) return true;
+    }
+    for (; frame != NULL; frame = frame->enclosing) {
+        for (int i = 0; i < frame->command_count; i++) {
+            if (strcmp(frame->commands[i]->as.command_def.name.value, name) == 0) return true;
+        }
+    }
+    return false;
+}
+
+static int declare(Frame* frame, const char* name) {
+    if (frame->count >= frame->capacity) {
+        frame->capacity = frame->capacity ? frame->capacity * 2 : 16;
+        frame->names = realloc(frame->names, sizeof(const char*) * frame->capacity);
+    }
+    frame->names[frame->count] = name;
+    return frame->count++;
+}
+
+// Assigning to a visible variable writes it, as in the type checker;
+// otherwise the assignment declares it in the current frame.
+static Binding bind_assignment(Resolver* r, const char* name) {
+    Binding binding;
+    if (!lookup(r->frame, name, &binding)) {
+        binding.depth = 0;
+        binding.slot = declare(r->frame, name);
+    }
+    return binding;
+}
+
+static void resolve_read(Resolver* r, Expression* expr) {
+    const char* name = expr->as.identifier.identifier.value;
+    if (lookup(r->frame, name, &expr->as.identifier.binding)) return;
+    expr->as.identifier.binding = (Binding){ .depth = 0, .slot = -1 };
+    if (!is_command_name(r->frame, name)) {
+        undefined_error(r, expr->base.line, name);
+    }
+}
+
+// Interpolated expressions stay inside the text until it's evaluated, so
+// only the variable each `${...}` starts with can be checked here.
+static void resolve_interpolation(Resolver* r, const char* text, int line) {
+    for (const char* p = text; *p != '\0'; p++) {
+        if (p[0] != '$' || p[1] != '{' || (p > text && p[-1] == '\\')) continue;
+        const char* start = p + 2;
+        const char* end = start;
+        while (isalnum((unsigned char)*end) || *end == '_') end++;
+        if (end == start || isdigit((unsigned char)*start)) continue;
+
+        char name[128];
+        size_t length = (size_t)(end - start) < sizeof(name) - 1 ? (size_t)(end - start) : sizeof(name) - 1;
+        memcpy(name, start, length);
+        name[length] = '\0';
+        Binding binding;
+        if (!lookup(r->frame, name, &binding) && !is_command_name(r->frame, name)) {
+            undefined_error(r, line, name);
+        }
+        p = end - 1;
+    }
+}
+
+static void resolve_expression(Resolver* r, Expression* expr) {
+    if (expr == NULL) return;
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            if (expr->as.literal.literal.type == T_STRING && expr->as.literal.literal.value != NULL) {
+                resolve_interpolation(r, expr->as.literal.literal.value, expr->base.line);
+            }
+            break;
+        case EXPR_IDENTIFIER:
+            resolve_read(r, expr);
+            break;
+        case EXPR_BINARY:
+            resolve_expression(r, expr->as.binary.left);
+            resolve_expression(r, expr->as.binary.right);
+            break;
+        case EXPR_UNARY:
+            resolve_expression(r, expr->as.unary.right);
+            break;
+        case EXPR_GROUPING:
+            resolve_expression(r, expr->as.grouping.expression);
+            break;
+        case EXPR_IN:
+            resolve_expression(r, expr->as.in_expr.left);
+            resolve_expression(r, expr->as.in_expr.right);
+            break;
+        case EXPR_CALL:
+            // A bare callee names a command or builtin, not a variable.
+            if (expr->as.call.callee->type != EXPR_IDENTIFIER) {
+                resolve_expression(r, expr->as.call.callee);
+            }
+            for (int i = 0; i < expr->as.call.count; i++) {
+                resolve_expression(r, expr->as.call.args[i]);
+            }
+            break;
+        case EXPR_GET:
+            resolve_expression(r, expr->as.get.object);
+            break;
+        case EXPR_LIST:
+            for (int i = 0; i < expr->as.list.count; i++) {
+                resolve_expression(r, expr->as.list.elements[i]);
+            }
+            break;
+        case EXPR_MAP:
+            for (int i = 0; i < expr->as.map.count; i++) {
+                resolve_expression(r, expr->as.map.keys[i]);
+                resolve_expression(r, expr->as.map.values[i]);
+            }
+            break;
+    }
+}
+
+static void add_command(Frame* frame, Statement* command) {
+    if (frame->command_count >= frame->command_capacity) {
+        frame->command_capacity = frame->command_capacity ? frame->command_capacity * 2 : 8;
+        frame->commands = realloc(frame->commands, sizeof(Statement*) * frame->command_capacity);
+    }
+    frame->commands[frame->command_count++] = command;
+}
+
+static void resolve_statement(Resolver* r, Statement* stmt) {
+    if (stmt == NULL) return;
+    switch (stmt->type) {
+        case STMT_LET_ASSIGN:
+            resolve_expression(r, stmt->as.let_assign.initializer);
+            stmt->as.let_assign.binding = bind_assignment(r, stmt->as.let_assign.name.value);
+            break;
+        case STMT_REASSIGN: {
+            resolve_expression(r, stmt->as.reassign.value);
+            Expression* target = stmt->as.reassign.target;
+            if (target->type == EXPR_IDENTIFIER) {
+                target->as.identifier.binding = bind_assignment(r, target->as.identifier.identifier.value);
+            } else {
+                resolve_expression(r, target);
+            }
+            break;
+        }
+        case STMT_IF:
+            resolve_expression(r, stmt->as.if_stmt.condition);
+            resolve_body(r, stmt->as.if_stmt.body, stmt->as.if_stmt.body_count);
+            resolve_statement(r, stmt->as.if_stmt.else_branch);
+            break;
+        case STMT_WHILE:
+            resolve_expression(r, stmt->as.while_stmt.condition);
+            resolve_body(r, stmt->as.while_stmt.body, stmt->as.while_stmt.body_count);
+            break;
+        case STMT_LOOP:
+            resolve_expression(r, stmt->as.loop_stmt.count);
+            resolve_body(r, stmt->as.loop_stmt.body, stmt->as.loop_stmt.body_count);
+            break;
+        case STMT_CHECK:
+            resolve_expression(r, stmt->as.check_stmt.subject);
+            for (int i = 0; i < stmt->as.check_stmt.case_count; i++) {
+                resolve_expression(r, stmt->as.check_stmt.cases[i].value);
+                resolve_body(r, stmt->as.check_stmt.cases[i].body, stmt->as.check_stmt.cases[i].body_count);
+            }
+            break;
+        case STMT_COMMAND_DEF:
+            add_command(r->frame, stmt);
+            break;
+        case STMT_WRITE:
+            resolve_expression(r, stmt->as.write_stmt.expression);
+            break;
+        case STMT_ASK:
+            resolve_expression(r, stmt->as.ask_stmt.prompt);
+            stmt->as.ask_stmt.binding = bind_assignment(r, stmt->as.ask_stmt.variable.value);
+            break;
+        case STMT_WAIT:
+            resolve_expression(r, stmt->as.wait_stmt.seconds);
+            break;
+        case STMT_RETURN:
+            resolve_expression(r, stmt->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            resolve_expression(r, stmt->as.expr_stmt.expression);
+            break;
+        default:
+            break;
+    }
+}
+
+static void resolve_body(Resolver* r, Statement** body, int count) {
+    for (int i = 0; i < count; i++) {
+        resolve_statement(r, body[i]);
+    }
+}
+
+static void resolve_command_frame(Resolver* r, Frame* enclosing, Statement* command);
+
+// Command bodies are resolved after the rest of their frame, so they can
+// use variables the frame assigns below the definition.
+static void resolve_frame(Resolver* r, Frame* frame, Statement** body, int count) {
+    Frame* saved_frame = r->frame;
+    r->frame = frame;
+    resolve_body(r, body, count);
+    for (int i = 0; i < frame->command_count; i++) {
+        if (frame->commands[i]->as.command_def.parsed) {
+            resolve_command_frame(r, frame, frame->commands[i]);
+        }
+    }
+    r->frame = saved_frame;
+}
+
+static void resolve_command_frame(Resolver* r, Frame* enclosing, Statement* command) {
+    Frame frame = { .names = NULL, .count = 0, .capacity = 0,
+        .commands = NULL, .command_count = 0, .command_capacity = 0, .enclosing = enclosing };
+    for (int i = 0; i < command->as.command_def.param_count; i++) {
+        declare(&frame, command->as.command_def.params[i].value);
+    }
+    resolve_frame(r, &frame, command->as.command_def.body, command->as.command_def.body_count);
+    command->as.command_def.frame_size = frame.count;
+    free(frame.names);
+    free(frame.commands);
+}
+
+// Binds every variable in the program to a frame slot and reports reads of
+// variables that are never assigned before them. The top-level names are
+// kept on the program for commands resolved later by resolve_command.
+bool resolve_program(ProgramNode* program, const ErrorReporter* reporter) {
+    Resolver resolver = { .frame = NULL, .error_count = 0,
+        .reported = NULL, .reported_count = 0, .reported_capacity = 0, .reporter = reporter };
+    Frame globals = { .names = NULL, .count = 0, .capacity = 0,
+        .commands = NULL, .command_count = 0, .command_capacity = 0, .enclosing = NULL };
+    resolve_frame(&resolver, &globals, program->statements, program->count);
+
+    free(program->globals);
+    program->globals = globals.names;
+    program->global_count = globals.count;
+    free(globals.commands);
+    free(resolver.reported);
+    return resolver.error_count == 0;
+}
+
+// Resolves a command body built by parse_command_body against the
+// program's top-level frame.
+bool resolve_command(ProgramNode* program, Statement* command, const ErrorReporter* reporter) {
+    Resolver resolver = { .frame = NULL, .error_count = 0,
+        .reported = NULL, .reported_count = 0, .reported_capacity = 0, .reporter = reporter };
+    Frame globals = { .names = program->globals, .count = program->global_count,
+        .capacity = program->global_count, .commands = program->commands,
+        .command_count = command->as.command_def.visible_commands, .command_capacity = 0, .enclosing = NULL };
+    resolve_command_frame(&resolver, &globals, command);
+    free(resolver.reported);
+    return resolver.error_count == 0;
+}
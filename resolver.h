@@ -0,0 +1,9 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "parser.h"
+
+bool resolve_program(ProgramNode* program, const ErrorReporter* reporter);
+bool resolve_command(ProgramNode* program, Statement* command, const ErrorReporter* reporter);
+
+#endif
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "text.h"
+
+// Texts are copied into `parallel loop` workers, so buffers can be shared
+// across threads and their counts change atomically.
+struct TextBuffer {
+    atomic_int refs;
+    size_t capacity;
+    char data[];
+};
+
+static bool is_inline(const FlintText* text) {
+    return text->length <= TEXT_INLINE_CAPACITY;
+}
+
+static TextBuffer* new_buffer(size_t capacity) {
+    TextBuffer* buffer = malloc(sizeof(TextBuffer) + capacity + 1);
+    atomic_init(&buffer->refs, 1);
+    buffer->capacity = capacity;
+    return buffer;
+}
+
+static void release_buffer(TextBuffer* buffer) {
+    if (atomic_fetch_sub(&buffer->refs, 1) == 1) {
+        free(buffer);
+    }
+}
+
+FlintText text_from(const char* data, size_t length) {
+    FlintText text;
+    text.length = length;
+    char* dest;
+    if (is_inline(&text)) {
+        dest = text.as.inline_data;
+    } else {
+        text.as.buffer = new_buffer(length);
+        dest = text.as.buffer->data;
+    }
+    memcpy(dest, data, length);
+    dest[length] = '\0';
+    return text;
+}
+
+// Copies share the heap buffer; it is only duplicated when a copy appends.
+FlintText text_copy(const FlintText* text) {
+    FlintText copy = *text;
+    if (!is_inline(text)) {
+        atomic_fetch_add(&text->as.buffer->refs, 1);
+    }
+    return copy;
+}
+
+void text_release(FlintText* text) {
+    if (!is_inline(text)) {
+        release_buffer(text->as.buffer);
+    }
+    text->length = 0;
+    text->as.inline_data[0] = '\0';
+}
+
+const char* text_data(const FlintText* text) {
+    return is_inline(text) ? text->as.inline_data : text->as.buffer->data;
+}
+
+// Appends in place when the buffer is unshared and has room. Otherwise the
+// text moves to a new buffer with doubled capacity, so `s += piece` in a
+// loop costs amortized O(len(piece)) instead of copying `s` every time.
+void text_append(FlintText* text, const char* data, size_t length) {
+    size_t new_length = text->length + length;
+    if (new_length <= TEXT_INLINE_CAPACITY) {
+        memcpy(text->as.inline_data + text->length, data, length);
+        text->as.inline_data[new_length] = '\0';
+        text->length = new_length;
+        return;
+    }
+
+    if (is_inline(text) || atomic_load(&text->as.buffer->refs) > 1 || text->as.buffer->capacity < new_length) {
+        size_t capacity = is_inline(text) ? TEXT_INLINE_CAPACITY * 2 : text->as.buffer->capacity * 2;
+        if (capacity < new_length) capacity = new_length;
+        // `data` may point into the old storage (`s += s`), so it is copied
+        // before that storage is released or overwritten.
+        TextBuffer* buffer = new_buffer(capacity);
+        memcpy(buffer->data, text_data(text), text->length);
+        memcpy(buffer->data + text->length, data, length);
+        buffer->data[new_length] = '\0';
+        if (!is_inline(text)) {
+            release_buffer(text->as.buffer);
+        }
+        text->as.buffer = buffer;
+        text->length = new_length;
+        return;
+    }
+
+    memcpy(text->as.buffer->data + text->length, data, length);
+    text->as.buffer->data[new_length] = '\0';
+    text->length = new_length;
+}
+
+// Always copies `left` when it is a live variable, since the variable still
+// shares its buffer; `s += piece` is lowered to text_append instead.
+FlintText text_concat(const FlintText* left, const FlintText* right) {
+    FlintText result = text_copy(left);
+    text_append(&result, text_data(right), right->length);
+    return result;
+}
+
+bool text_equals(const FlintText* left, const FlintText* right) {
+    if (left->length != right->length) return false;
+    if (!is_inline(left) && left->as.buffer == right->as.buffer) return true;
+    return memcmp(text_data(left), text_data(right), left->length) == 0;
+}
@@ -0,0 +1,30 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TEXT_INLINE_CAPACITY 15
+
+typedef struct TextBuffer TextBuffer;
+
+// A text value. Up to TEXT_INLINE_CAPACITY bytes are stored inline; longer
+// texts point at a reference-counted buffer that copies share until one of
+// them is modified. Data is always NUL-terminated.
+typedef struct {
+    size_t length;
+    union {
+        char inline_data[TEXT_INLINE_CAPACITY + 1];
+        TextBuffer* buffer;
+    } as;
+} FlintText;
+
+FlintText text_from(const char* data, size_t length);
+FlintText text_copy(const FlintText* text);
+void text_release(FlintText* text);
+const char* text_data(const FlintText* text);
+void text_append(FlintText* text, const char* data, size_t length);
+FlintText text_concat(const FlintText* left, const FlintText* right);
+bool text_equals(const FlintText* left, const FlintText* right);
+
+#endif
@@ -22,11 +22,11 @@ static void push_indent(IndentStack *stack, const char *indent);
 static void pop_indent(IndentStack *stack);
 static int is_keyword(const char *str, int len);
 
-Token* tokenize(const char* code, int* token_count) {
+Token* tokenize(const char* code, int* token_count, const ErrorReporter* reporter) {
     TokenList tokens = { .items = malloc(sizeof(Token) * 64), .count = 0, .capacity = 64 };
     IndentStack indent_stack = { .items = malloc(sizeof(char*) * 16), .count = 0, .capacity = 16 };
     if (!tokens.items || !indent_stack.items) {
-        fprintf(stderr, "Error: Memory allocation failed.\n");
+        report_error(reporter, "Error: Memory allocation failed.");
         free(tokens.items);
         free(indent_stack.items);
         return NULL;
@@ -43,7 +43,7 @@ Token* tokenize(const char* code, int* token_count) {
         if (strncmp(p, "-;", 2) == 0) open_comments--;
     }
     if (open_comments != 0) {
-        fprintf(stderr, "SyntaxError: Unbalanced multi-line comments.\n");
+        report_error(reporter, "SyntaxError: Unbalanced multi-line comments.");
         free(tokens.items);
         while (indent_stack.count > 0) pop_indent(&indent_stack);
         free(indent_stack.items);
@@ -92,7 +92,7 @@ Token* tokenize(const char* code, int* token_count) {
                         pop_indent(&indent_stack);
                     }
                     if (strcmp(indent_stack.items[indent_stack.count - 1], current_indent) != 0) {
-                       fprintf(stderr, "IndentationError at line %d: unindent does not match any outer indentation level\n", line);
+                       report_error(reporter, "IndentationError at line %d: unindent does not match any outer indentation level", line);
                        free(current_indent);
                        free_tokens(tokens.items, tokens.count);
                        while(indent_stack.count > 0) pop_indent(&indent_stack);
@@ -191,7 +191,7 @@ Token* tokenize(const char* code, int* token_count) {
         }
 
         if (cursor == start) {
-            fprintf(stderr, "SyntaxError: Illegal character '%c' at line %d\n", *cursor, line);
+            report_error(reporter, "SyntaxError: Illegal character '%c' at line %d", *cursor, line);
             free_tokens(tokens.items, tokens.count);
             while(indent_stack.count > 0) pop_indent(&indent_stack);
             free(indent_stack.items);
@@ -290,7 +290,8 @@ static int is_keyword(const char *str, int len) {
     const char *keywords[] = {
         "start", "let", "if", "else", "while", "loop", "command", "object", 
         "check", "equals", "write", "ask", "as", "wait", "null", 
-        "num", "text", "bool", "list", "map", "return", "in", "break", "continue"
+        "num", "text", "bool", "list", "map", "return", "in", "break", "continue",
+        "parallel"
     };
     int num_keywords = sizeof(keywords) / sizeof(char *);
     for (int i = 0; i < num_keywords; i++) {
@@ -1,6 +1,8 @@
 #ifndef TOKENIZER_H
 #define TOKENIZER_H
 
+#include "error.h"
+
 typedef enum {
     T_MLCOMMENT, T_COMMENT, T_NUMBER, T_STRING, T_BOOL,
     T_INC_DEC, T_COMP_OP, T_COMP_ASSIGN, T_ASSIGN, T_COLON,
@@ -17,7 +19,7 @@ typedef struct {
 } Token;
 
 const char* token_type_to_string(TokenType type);
-Token* tokenize(const char* code, int* token_count);
+Token* tokenize(const char* code, int* token_count, const ErrorReporter* reporter);
 void free_tokens(Token* tokens, int token_count);
 
 #endif
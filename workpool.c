@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include "workpool.h"
+
+#define DEQUE_CAPACITY 64
+#define SPLITS_PER_WORKER 16
+
+typedef struct {
+    long begin;
+    long end;
+} Range;
+
+// Each worker owns a deque of iteration ranges. The owner pushes and pops
+// at the bottom, splitting big ranges in half as it goes; idle workers
+// steal from the top, where the oldest and largest ranges sit.
+typedef struct {
+    pthread_mutex_t lock;
+    Range ranges[DEQUE_CAPACITY];
+    int top;
+    int bottom;
+} Deque;
+
+typedef struct {
+    WorkPool* pool;
+    int index;
+} WorkerArgs;
+
+struct WorkPool {
+    int size;
+    pthread_t* threads;
+    WorkerArgs* args;
+    Deque* deques;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    long generation;
+    int finished;
+    bool shutting_down;
+
+    ParallelBodyFn body;
+    void* context;
+    long grain;
+    atomic_long remaining;
+};
+
+static bool push_bottom(Deque* deque, Range range) {
+    bool pushed = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom == DEQUE_CAPACITY && deque->top > 0) {
+        memmove(deque->ranges, deque->ranges + deque->top, sizeof(Range) * (deque->bottom - deque->top));
+        deque->bottom -= deque->top;
+        deque->top = 0;
+    }
+    if (deque->bottom < DEQUE_CAPACITY) {
+        deque->ranges[deque->bottom++] = range;
+        pushed = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return pushed;
+}
+
+static bool pop_bottom(Deque* deque, Range* range) {
+    bool popped = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->top < deque->bottom) {
+        *range = deque->ranges[--deque->bottom];
+        popped = true;
+    }
+    if (deque->top == deque->bottom) {
+        deque->top = deque->bottom = 0;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return popped;
+}
+
+static bool steal_top(Deque* deque, Range* range) {
+    bool stolen = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->top < deque->bottom) {
+        *range = deque->ranges[deque->top++];
+        stolen = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return stolen;
+}
+
+static bool steal(WorkPool* pool, int thief, Range* range) {
+    for (int i = 1; i < pool->size; i++) {
+        if (steal_top(&pool->deques[(thief + i) % pool->size], range)) return true;
+    }
+    return false;
+}
+
+static void work(WorkPool* pool, int index) {
+    Deque* own = &pool->deques[index];
+    while (atomic_load(&pool->remaining) > 0) {
+        Range range;
+        if (!pop_bottom(own, &range) && !steal(pool, index, &range)) {
+            sched_yield();
+            continue;
+        }
+        while (range.end - range.begin > pool->grain) {
+            long mid = range.begin + (range.end - range.begin) / 2;
+            if (!push_bottom(own, (Range){ mid, range.end })) break;
+            range.end = mid;
+        }
+        for (long i = range.begin; i < range.end; i++) {
+            pool->body(pool->context, i, index);
+        }
+        atomic_fetch_sub(&pool->remaining, range.end - range.begin);
+    }
+}
+
+static void* worker_main(void* arg) {
+    WorkerArgs* args = arg;
+    WorkPool* pool = args->pool;
+    long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen && !pool->shutting_down) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->shutting_down) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        work(pool, args->index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (++pool->finished == pool->size - 1) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Creates a pool of `workers` workers. The thread calling work_pool_run is
+// worker 0, so `workers - 1` threads are started.
+WorkPool* work_pool_new(int workers) {
+    WorkPool* pool = malloc(sizeof(WorkPool));
+    if (pool == NULL) return NULL;
+    pool->size = workers > 0 ? workers : 1;
+    pool->threads = malloc(sizeof(pthread_t) * pool->size);
+    pool->args = malloc(sizeof(WorkerArgs) * pool->size);
+    pool->deques = malloc(sizeof(Deque) * pool->size);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->generation = 0;
+    pool->finished = 0;
+    pool->shutting_down = false;
+    atomic_init(&pool->remaining, 0);
+
+    for (int i = 0; i < pool->size; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+        pool->deques[i].top = pool->deques[i].bottom = 0;
+        pool->args[i].pool = pool;
+        pool->args[i].index = i;
+    }
+    for (int i = 1; i < pool->size; i++) {
+        pthread_create(&pool->threads[i], NULL, worker_main, &pool->args[i]);
+    }
+    return pool;
+}
+
+void work_pool_free(WorkPool* pool) {
+    if (pool == NULL) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutting_down = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->size; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->size; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->deques);
+    free(pool->args);
+    free(pool->threads);
+    free(pool);
+}
+
+int work_pool_size(const WorkPool* pool) {
+    return pool->size;
+}
+
+// Runs body(context, i, worker) for every i in [0, count) and returns once
+// all iterations have finished. Not reentrant: one run per pool at a time.
+void work_pool_run(WorkPool* pool, long count, ParallelBodyFn body, void* context) {
+    if (count <= 0) return;
+
+    pool->body = body;
+    pool->context = context;
+    pool->grain = count / ((long)pool->size * SPLITS_PER_WORKER);
+    if (pool->grain < 1) pool->grain = 1;
+
+    long chunk = count / pool->size;
+    for (int i = 0; i < pool->size; i++) {
+        long begin = chunk * i;
+        long end = i == pool->size - 1 ? count : begin + chunk;
+        if (begin < end) push_bottom(&pool->deques[i], (Range){ begin, end });
+    }
+    atomic_store(&pool->remaining, count);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->finished = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    work(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->finished < pool->size - 1) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
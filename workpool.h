@@ -0,0 +1,16 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+// Runs the iterations of a `parallel loop` body. The worker index passed to
+// the body (0 .. size - 1) lets callers keep per-worker partial values for
+// reductions and combine them once work_pool_run returns.
+typedef void (*ParallelBodyFn)(void* context, long iteration, int worker);
+
+typedef struct WorkPool WorkPool;
+
+WorkPool* work_pool_new(int workers);
+void work_pool_free(WorkPool* pool);
+int work_pool_size(const WorkPool* pool);
+void work_pool_run(WorkPool* pool, long count, ParallelBodyFn body, void* context);
+
+#endif